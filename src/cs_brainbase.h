@@ -27,6 +27,18 @@ class CS_BrainBase
     virtual CS_Chromo MakeBrainChromo() const { return {}; }
 
     virtual void AnimateBrain(const CSM_Vec& ins, CSM_Vec& outs) const = 0;
+
+    // n rows of inputs and outputs, contiguous, in a single virtual call
+    // (models override this to run their forward pass in a loop that the compiler can see through)
+    virtual void AnimateBrainBatch(size_t n, const CS_SCALAR* pIns, size_t insN, CS_SCALAR* pOuts, size_t outsN) const
+    {
+        for (size_t i = 0; i < n; ++i)
+        {
+            const CSM_Vec ins(pIns + i * insN, insN);
+            CSM_Vec outs(pOuts + i * outsN, outsN);
+            AnimateBrain(ins, outs);
+        }
+    }
 };
 
 #endif
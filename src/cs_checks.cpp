@@ -0,0 +1,582 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include <glm/gtc/constants.hpp>
+#include "log/log.h"
+#include "cs_checks.h"
+#include "cs_m1_brain.h"
+#include "cs_m1_train.h"
+#include "cs_novelty.h"
+#include "cs_sim.h"
+#include "cs_terrain.h"
+#include "cs_threadpool.h"
+#include "cs_trajrec.h"
+#include "cs_unit.h"
+#include "utils.h"
+
+namespace CS_Checks
+{
+    static void checkLog(const char* ftm, ...)
+    {
+        char buffer[2048]{};
+        va_list args;
+        va_start(args, ftm);
+        vsnprintf(buffer, sizeof(buffer), ftm, args);
+        va_end(args);
+        LOGGER(logging::INFO) << buffer;
+    }
+
+    //==================================================================
+    // novelty archive: the cap of k entries per cell keeps the queries fast as the insertions grow,
+    // and it can't move a novelty score by more than the diagonal of a cell
+    static constexpr double NOVELTY_MAX_QUERY_GROWTH = 4.0; // query time, at 300k insertions vs 10k
+
+    static bool check_NoveltyArchive()
+    {
+        const size_t K      = 15;
+        const double CELL_S = 1.0 / 64;
+
+        // behaviors as final positions normalized by the field size: crowded around a few spots, plus strays
+        std::mt19937 rng(1);
+        std::uniform_real_distribution<double> uni(-0.5, 0.5);
+        std::normal_distribution<double> nor(0.0, 0.02);
+        std::vector<CS_BehaviorDesc> spots(8);
+        for (auto& s : spots) s = {uni(rng) * 0.8, uni(rng) * 0.8};
+        auto makeDesc = [&]() -> CS_BehaviorDesc {
+            if (rng() % 10 < 3) return {uni(rng), uni(rng)};
+            const auto& s = spots[rng() % spots.size()];
+            return {std::clamp(s.x + nor(rng), -0.5, 0.5), std::clamp(s.z + nor(rng), -0.5, 0.5)};
+        };
+
+        std::vector<CS_BehaviorDesc> queries(2000);
+        for (auto& q : queries) q = makeDesc();
+
+        bool pass             = true;
+        double firstQueryUS   = 0;
+        const size_t insNs[3] = {10000, 100000, 300000};
+        for (const auto insN : insNs)
+        {
+            CS_NoveltyArchive archive(K, CELL_S);
+            std::vector<CS_BehaviorDesc> all(insN);
+            for (auto& d : all)
+            {
+                d = makeDesc();
+                archive.AddDesc(d);
+            }
+
+            const auto t0 = ut::GetSteadyTimeS();
+            double sum    = 0;
+            for (const auto& q : queries) sum += archive.CalcNovelty(q, {}, 0);
+            const auto queryUS = (ut::GetSteadyTimeS() - t0) * 1e6 / (double)queries.size();
+            if (!firstQueryUS) firstQueryUS = queryUS;
+
+            // the same scores without the cap, by brute force on a subset of the queries
+            double maxErr = 0;
+            std::vector<double> dists(insN);
+            for (size_t qi = 0; qi < queries.size(); qi += 10)
+            {
+                for (size_t i = 0; i < insN; ++i) dists[i] = queries[qi].DistTo(all[i]);
+                std::nth_element(dists.begin(), dists.begin() + (ptrdiff_t)(K - 1), dists.end());
+                double exact = 0;
+                for (size_t i = 0; i < K; ++i) exact += dists[i] / (double)K;
+                maxErr = std::max(maxErr, std::abs(archive.CalcNovelty(queries[qi], {}, 0) - exact));
+            }
+
+            const auto maxErrTol = CELL_S * std::sqrt(2.0);
+            const auto ok        = maxErr <= maxErrTol && queryUS <= firstQueryUS * NOVELTY_MAX_QUERY_GROWTH;
+            checkLog("Novelty archive, %zu insertions: %zu entries, %.2f us/query, max novelty err %.5f (tol %.5f) %s",
+                     insN, archive.GetEntriesN(), queryUS, maxErr, maxErrTol, ok ? "OK" : "FAIL");
+            pass = pass && ok && sum > 0;
+        }
+        return pass;
+    }
+
+    //==================================================================
+    // a sim on the default terrain, with episodesN episodes at open spots and unitsPerEpN units each
+    static std::unique_ptr<CS_Sim> makeOpenSim(CS_Terrain& terr, const CS_BrainBase& brain, size_t episodesN,
+                                               size_t unitsPerEpN)
+    {
+        auto isOpen = [&](const glm::vec3& pos) {
+            for (int iz = -15; iz <= 15; iz += 3)
+                for (int ix = -15; ix <= 15; ix += 3)
+                {
+                    const auto p = pos + glm::vec3((float)ix, 0.f, (float)iz) * terr.GetCellSize();
+                    if (!terr.IsPosInside(p) || terr.GetHeightFromPos(p) >= CS_Sim::GetWallHeight_s()) return false;
+                }
+            return true;
+        };
+
+        std::vector<glm::vec3> poss;
+        const auto fieldSize = terr.GetFieldSize();
+        for (int iz = 0; iz < 64; ++iz)
+            for (int ix = 0; ix < 64; ++ix)
+            {
+                const auto pos = (glm::vec3((float)ix, 0, (float)iz) / 64.f - glm::vec3(0.5f, 0, 0.5f)) * fieldSize;
+                if (isOpen(pos)) poss.push_back(pos);
+            }
+
+        CS_Sim::Params par;
+        par.mInitUnitsN = unitsPerEpN;
+        par.mMaxTimeS   = 60;
+        for (size_t i = 0; i < episodesN && !poss.empty(); ++i)
+        {
+            CS_Sim::Episode ep;
+            ep.mStartPos  = poss[(i * 97) % poss.size()];
+            ep.mTargetPos = poss[(i * 97 + poss.size() / 2) % poss.size()];
+            par.mEpisodes.push_back(ep);
+        }
+        return std::make_unique<CS_Sim>(par, terr, brain, false);
+    }
+
+    // microseconds per AnimSim() call, over the first stepsN steps of a fresh sim (best of a few sims)
+    static double timeAnimSim(CS_Terrain& terr, const CS_BrainBase& brain, size_t episodesN, size_t unitsPerEpN,
+                              size_t stepsN)
+    {
+        double bestUS = 1e30;
+        for (size_t k = 0; k < 5; ++k)
+        {
+            auto oSim     = makeOpenSim(terr, brain, episodesN, unitsPerEpN);
+            const auto t0 = ut::GetSteadyTimeS();
+            for (size_t i = 0; i < stepsN; ++i) oSim->AnimSim(1.0 / 60, false);
+            bestUS = std::min(bestUS, (ut::GetSteadyTimeS() - t0) * 1e6 / (double)stepsN);
+        }
+        return bestUS;
+    }
+
+    //==================================================================
+    // Model 1 brain: the batched forward pass gives the outputs of the one of a single row, in less time
+    static constexpr double BRAIN_BATCH_MAX_ERR = 1e-5;
+
+    static bool check_BrainBatch()
+    {
+        const CS_M1_Brain brain(1, CS_SENS_N, CS_CTRL_N);
+
+        const size_t ROWS_N = 256;
+        std::mt19937 rng(1);
+        std::uniform_real_distribution<CS_SCALAR> uni(-1, 1);
+        std::vector<CS_SCALAR> ins(ROWS_N * CS_SENS_N);
+        for (auto& x : ins) x = uni(rng);
+        std::vector<CS_SCALAR> outsRow(ROWS_N * CS_CTRL_N);
+        std::vector<CS_SCALAR> outsBatch(ROWS_N * CS_CTRL_N);
+
+        auto runRows = [&]() {
+            for (size_t i = 0; i < ROWS_N; ++i)
+            {
+                const CSM_Vec in(ins.data() + i * CS_SENS_N, CS_SENS_N);
+                CSM_Vec out(outsRow.data() + i * CS_CTRL_N, CS_CTRL_N);
+                brain.AnimateBrain(in, out);
+            }
+        };
+        auto runBatch = [&]() {
+            brain.AnimateBrainBatch(ROWS_N, ins.data(), CS_SENS_N, outsBatch.data(), CS_CTRL_N);
+        };
+        // best of a few runs, as other processes only ever add time
+        auto timeUS = [&](const auto& fn) {
+            const size_t REPS_N = 400;
+            double bestUS       = 1e30;
+            for (size_t k = 0; k < 5; ++k)
+            {
+                const auto t0 = ut::GetSteadyTimeS();
+                for (size_t r = 0; r < REPS_N; ++r) fn();
+                bestUS = std::min(bestUS, (ut::GetSteadyTimeS() - t0) * 1e6 / REPS_N);
+            }
+            return bestUS;
+        };
+
+        const auto rowsUS  = timeUS(runRows);
+        const auto batchUS = timeUS(runBatch);
+        double maxErr      = 0;
+        for (size_t i = 0; i < outsRow.size(); ++i)
+            maxErr = std::max(maxErr, (double)std::abs(outsRow[i] - outsBatch[i]));
+
+        const auto ok = maxErr <= BRAIN_BATCH_MAX_ERR && batchUS <= rowsUS;
+        checkLog("Brain batch, %zu rows: %.2f us in a loop of rows, %.2f us batched, max err %g (tol %g) %s", ROWS_N,
+                 rowsUS, batchUS, maxErr, BRAIN_BATCH_MAX_ERR, ok ? "OK" : "FAIL");
+
+        // the step of a sim, for reference
+        CS_Terrain terr(CS_Terrain::Params{});
+        const auto sim1US   = timeAnimSim(terr, brain, 1, 1, 600);
+        const auto sim256US = timeAnimSim(terr, brain, 64, 4, 60);
+        checkLog("AnimSim: %.2f us/step with 1 unit, %.2f us/step with 256 units", sim1US, sim256US);
+
+        return ok;
+    }
+
+    //==================================================================
+    // parallel sim step: the chunks of units on the sim's threads give the same units as a serial step, in less
+    // time, from PARALLEL_MIN_UNITS_N units (with a single core both are the serial step, only the units are compared)
+    static bool check_SimParallel()
+    {
+        const CS_M1_Brain brain(1, CS_SENS_N, CS_CTRL_N);
+        CS_Terrain terr(CS_Terrain::Params{});
+        const auto coresN = CS_GetCoresN();
+
+        bool pass              = true;
+        const size_t unitsNs[] = {64, 256, 1024};
+        for (const auto unitsN : unitsNs)
+        {
+            const auto episodesN = unitsN / 4;
+            const auto stepsN    = std::max((size_t)10, 15360 / unitsN);
+
+            // the serial step as if evaluated by the trainer, in turns with the parallel one, so that both see the
+            // same load of the machine
+            double serialUS   = 1e30;
+            double parallelUS = 1e30;
+            for (size_t k = 0; k < 3; ++k)
+            {
+                {
+                    CS_InWorkerScope inWorker;
+                    serialUS = std::min(serialUS, timeAnimSim(terr, brain, episodesN, 4, stepsN));
+                }
+                parallelUS = std::min(parallelUS, timeAnimSim(terr, brain, episodesN, 4, stepsN));
+            }
+
+            // same units after a few seconds
+            auto oSerSim = makeOpenSim(terr, brain, episodesN, 4);
+            auto oParSim = makeOpenSim(terr, brain, episodesN, 4);
+            for (size_t i = 0; i < 180; ++i)
+            {
+                {
+                    CS_InWorkerScope inWorker;
+                    oSerSim->AnimSim(1.0 / 60, false);
+                }
+                oParSim->AnimSim(1.0 / 60, false);
+            }
+            bool isSame = true;
+            for (size_t i = 0; i < oSerSim->GetUnitsN(); ++i)
+            {
+                const auto a = oSerSim->GetUnitPose(i);
+                const auto b = oParSim->GetUnitPose(i);
+                isSame       = isSame && a.mPosX == b.mPosX && a.mPosZ == b.mPosZ && a.mYaw == b.mYaw &&
+                         a.mRunningState == b.mRunningState;
+            }
+
+            const auto ok = isSame && (coresN <= 1 || parallelUS < serialUS);
+            checkLog("Sim parallel, %zu units on %zu cores: %.1f us/step serial, %.1f us/step parallel (%.2fx%s), "
+                     "%s units %s",
+                     unitsN, coresN, serialUS, parallelUS, serialUS / parallelUS, coresN <= 1 ? ", not compared" : "",
+                     isSame ? "same" : "DIFFERENT", ok ? "OK" : "FAIL");
+            pass = pass && ok;
+        }
+        return pass;
+    }
+
+    //==================================================================
+    // trajectory recorder: what's read back is what was recorded, within the quantization,
+    // and recording slows the sim step by only a few %
+    static constexpr double TRAJREC_MAX_OVERHEAD = 0.05; // of the time of AnimSim()
+
+    static bool check_TrajRecorder()
+    {
+        const CS_M1_Brain brain(1, CS_SENS_N, CS_CTRL_N);
+        CS_Terrain terr(CS_Terrain::Params{});
+        const auto fname = (std::filesystem::temp_directory_path() / "cs_check_trajs.bin").string();
+
+        // round trip, with the poses taken from the sim after each step
+        const size_t STEPS_N = 600;
+        auto oSim            = makeOpenSim(terr, brain, 16, 4);
+        const auto unitsN    = oSim->GetUnitsN();
+        std::vector<CS_TrajSample> poses;
+        std::vector<double> times;
+        if (!oSim->StartRecording(fname))
+        {
+            checkLog("Trajectory recorder: can't create %s FAIL", fname.c_str());
+            return false;
+        }
+        for (size_t i = 0; i < STEPS_N; ++i)
+        {
+            oSim->AnimSim(1.0 / 60, false);
+            times.push_back(oSim->GetCurSimTimeS());
+            for (size_t u = 0; u < unitsN; ++u) poses.push_back(oSim->GetUnitPose(u));
+        }
+        oSim->StopRecording();
+
+        CS_TrajReader reader;
+        bool ok = reader.Open(fname) && reader.GetUnitsN() == unitsN && reader.GetStepsN() == STEPS_N;
+
+        const auto posTol       = 0.5 / CS_TrajRecorder::POS_QUANT + 1e-5;
+        const auto yawTol       = 0.5 / CS_TrajRecorder::YAW_QUANT + 1e-5;
+        const auto costTol      = 0.5 / CS_TrajRecorder::COST_QUANT + 1e-5;
+        const auto ctrlTol      = 0.5 / CS_TrajRecorder::CTRL_QUANT + 1e-5;
+        double maxPosErr        = 0;
+        double maxYawErr        = 0;
+        double maxCostErr       = 0;
+        double maxCtrlErr       = 0;
+        size_t stateMismatchesN = 0;
+        for (size_t i = 0; i < STEPS_N && ok; ++i)
+            for (size_t u = 0; u < unitsN && ok; ++u)
+            {
+                CS_TrajSample smpStep;
+                CS_TrajSample smpTime;
+                ok = reader.ReadSampleAtStep(u, i, smpStep) && reader.ReadSampleAtTime(u, times[i], smpTime) &&
+                     !std::memcmp(&smpStep, &smpTime, sizeof(smpStep));
+
+                const auto& p = poses[i * unitsN + u];
+                maxPosErr     = std::max({maxPosErr, (double)std::abs(smpStep.mPosX - p.mPosX),
+                                          (double)std::abs(smpStep.mPosZ - p.mPosZ)});
+                maxYawErr     = std::max(maxYawErr, (double)std::abs(smpStep.mYaw - p.mYaw));
+                maxCostErr    = std::max(maxCostErr, (double)std::abs(smpStep.mFinalCost - p.mFinalCost));
+                for (size_t j = 0; j < CS_CTRL_N; ++j)
+                    maxCtrlErr = std::max(maxCtrlErr, (double)std::abs(smpStep.mControls[j] - p.mControls[j]));
+                stateMismatchesN += smpStep.mRunningState != p.mRunningState ? 1 : 0;
+            }
+        const auto fileBytes = std::filesystem::file_size(fname);
+        std::filesystem::remove(fname);
+
+        ok = ok && maxPosErr <= posTol && maxYawErr <= yawTol && maxCostErr <= costTol && maxCtrlErr <= ctrlTol &&
+             !stateMismatchesN;
+        checkLog("Trajectory recorder, %zu units x %zu steps: %.1f bytes/sample, max err pos %.2g (tol %.2g), "
+                 "yaw %.2g (tol %.2g), cost %.2g (tol %.2g), controls %.2g (tol %.2g), %zu state mismatches %s",
+                 unitsN, STEPS_N, (double)fileBytes / (double)(unitsN * STEPS_N), maxPosErr, posTol, maxYawErr,
+                 yawTol, maxCostErr, costTol, maxCtrlErr, ctrlTol, stateMismatchesN, ok ? "OK" : "FAIL");
+
+        // overhead, on the steps of a big sim, alternating between the two ways, and taking the best of each
+        // (other processes only ever add time)
+        const size_t BIG_STEPS_N = 300;
+        double plainUS           = 1e30;
+        double recUS             = 1e30;
+        for (size_t k = 0; k < 16; ++k)
+        {
+            const auto doRecord = (k & 1) != 0;
+            auto oBigSim        = makeOpenSim(terr, brain, 64, 4);
+            if (doRecord) oBigSim->StartRecording(fname);
+            const auto t0 = ut::GetSteadyTimeS();
+            for (size_t i = 0; i < BIG_STEPS_N; ++i) oBigSim->AnimSim(1.0 / 60, false);
+            // the writer finishing the last chunk is part of the cost
+            oBigSim->StopRecording();
+            auto& dstUS = doRecord ? recUS : plainUS;
+            dstUS       = std::min(dstUS, (ut::GetSteadyTimeS() - t0) * 1e6 / BIG_STEPS_N);
+        }
+
+        // the difference above is within the noise of a shared machine, so the recorder is also timed on its own,
+        // quantizing, encoding and writing the same number of samples (as if the writer thread had no core of
+        // its own, an upper bound of what it adds to a step)
+        const size_t BIG_UNITS_N = 256;
+        std::vector<CS_TrajSample> smps(BIG_UNITS_N);
+        double recOnlyUS = 1e30;
+        for (size_t k = 0; k < 5; ++k)
+        {
+            const auto t0 = ut::GetSteadyTimeS();
+            {
+                CS_TrajRecorder rec(fname, BIG_UNITS_N);
+                for (size_t i = 0; i < BIG_STEPS_N; ++i)
+                {
+                    for (size_t u = 0; u < BIG_UNITS_N; ++u) smps[u] = poses[(i * unitsN + u) % poses.size()];
+                    rec.AddStep((double)i / 60, smps.data());
+                }
+            }
+            recOnlyUS = std::min(recOnlyUS, (ut::GetSteadyTimeS() - t0) * 1e6 / BIG_STEPS_N);
+        }
+        std::filesystem::remove(fname);
+
+        const auto overhead   = recOnlyUS / plainUS;
+        const auto overheadOk = overhead <= TRAJREC_MAX_OVERHEAD;
+        checkLog("Trajectory recorder, %zu units: %.1f us/step, %.1f us/step recording, %.1f us/step in the recorder "
+                 "alone, overhead %.1f%% (tol %.0f%%) %s",
+                 BIG_UNITS_N, plainUS, recUS, recOnlyUS, overhead * 100, TRAJREC_MAX_OVERHEAD * 100,
+                 overheadOk ? "OK" : "FAIL");
+
+        return ok && overheadOk;
+    }
+
+    //==================================================================
+    // exp drag integrator: at the larger steps it's meant for, it stays close to the reference at 1/60 s
+    // (only the motion of a unit, the crash and wall checks of the sim still happen once per step)
+    static bool check_Integrator()
+    {
+        const CS_Terrain terr(CS_Terrain::Params{});
+
+        bool pass = true;
+        for (const size_t stepsPerS : {60, 20, 15})
+        {
+            const auto stepS = 1.0 / (double)stepsPerS;
+            const auto err   = CS_Unit::CalcIntegratorErr(stepS);
+            const auto ok    = err.mMaxPosErrM <= CS_Unit::INTEGRATOR_MAX_POS_ERR_M &&
+                            err.mMaxYawErrRad <= CS_Unit::INTEGRATOR_MAX_YAW_ERR_RAD;
+            checkLog("Integrator at 1/%zu s: max pos err %.3f m (tol %.2f, over %.0f m), max yaw err %.4f rad "
+                     "(tol %.3f), up to %.1f cells per step at the speed bound %s",
+                     stepsPerS, err.mMaxPosErrM, CS_Unit::INTEGRATOR_MAX_POS_ERR_M, err.mDistM, err.mMaxYawErrRad,
+                     CS_Unit::INTEGRATOR_MAX_YAW_ERR_RAD, CS_Unit::GetSpeedBoundMS() * stepS / terr.GetCellSize(),
+                     ok ? "OK" : "FAIL");
+            pass = pass && ok;
+        }
+        return pass;
+    }
+
+    //==================================================================
+    // lidar: one ScanLidar() call is faster than a ScanRay() per beam, and it finds the first wall cell that
+    // each beam crosses, as a fine march along the beam does
+    // of the beams (the march misses the cells that a beam only clips at a corner)
+    static constexpr double LIDAR_MIN_EXACT_FRAC = 0.995;
+
+    static bool check_Lidar()
+    {
+        CS_Terrain::Params tpar;
+        tpar.tp_noise_barrierLev = 0.6f; // as in the scenario
+        const CS_Terrain terr(tpar);
+        const auto WALL_H = (float)CS_Sim::GetWallHeight_s();
+        const auto CELL_S = terr.GetCellSize();
+
+        // open spots all over the field, with random headings
+        std::mt19937 rng(1);
+        std::uniform_real_distribution<float> uni(-0.5f, 0.5f);
+        std::vector<glm::vec4> poss; // x, z, heading
+        while (poss.size() < 2000)
+        {
+            const auto pos = glm::vec3(uni(rng), 0, uni(rng)) * terr.GetFieldSize();
+            if (terr.GetHeightFromPos(pos) < WALL_H) poss.push_back({pos.x, 0, pos.z, uni(rng) * glm::two_pi<float>()});
+        }
+        auto calcBeamDir = [](const glm::vec4& p, size_t b, size_t beamsN) {
+            const auto ang = p.w + glm::two_pi<float>() * (float)b / (float)beamsN;
+            return glm::vec3(std::cos(ang), 0, std::sin(ang));
+        };
+
+        auto scanRays = [&](const glm::vec4& p, float range, size_t beamsN, float* pDists) {
+            const auto pos = glm::vec3(p.x, 0, p.z);
+            for (size_t b = 0; b < beamsN; ++b)
+            {
+                terr.ScanRay(pos, pos + range * calcBeamDir(p, b, beamsN),
+                             [&](const auto& cpos, const auto h, bool isOutsideMap) {
+                    if (h > WALL_H || isOutsideMap)
+                    {
+                        pDists[b] = std::min(pDists[b], glm::length(cpos - pos));
+                        return false;
+                    }
+                    return true;
+                });
+            }
+        };
+        auto scanLidar = [&](const glm::vec4& p, float range, size_t beamsN, float* pDists) {
+            terr.ScanLidar(glm::vec3(p.x, 0, p.z), p.w, range, WALL_H, beamsN, pDists);
+        };
+        // the reference, marching in steps of 1/100 of a cell, to the center of the first cell out of the map
+        // or above the walls (cell c covers [cellsOrig + c * CELL_S, cellsOrig + (c + 1) * CELL_S))
+        const auto cellsOrig = -terr.GetFieldSize() / 2 + CELL_S * 0.5f;
+        const auto cellsN    = (int)std::lround(terr.GetFieldSize() / CELL_S);
+        auto scanMarch       = [&](const glm::vec4& p, float range, size_t beamsN, float* pDists) {
+            const auto pos = glm::vec3(p.x, 0, p.z);
+            for (size_t b = 0; b < beamsN; ++b)
+            {
+                const auto dir = calcBeamDir(p, b, beamsN);
+                for (float t = 0; t <= range; t += CELL_S / 100)
+                {
+                    const auto mpos = pos + dir * t;
+                    const auto cx   = (int)std::floor((mpos.x - cellsOrig) / CELL_S);
+                    const auto cz   = (int)std::floor((mpos.z - cellsOrig) / CELL_S);
+                    if (cx < 0 || cx >= cellsN || cz < 0 || cz >= cellsN || terr.GetHeightFromPos(mpos) > WALL_H)
+                    {
+                        const auto cpos = glm::vec3(cellsOrig + ((float)cx + 0.5f) * CELL_S, 0,
+                                                    cellsOrig + ((float)cz + 0.5f) * CELL_S);
+                        pDists[b]       = std::min(pDists[b], glm::length(cpos - pos));
+                        break;
+                    }
+                }
+            }
+        };
+        // best of a few runs, microseconds per scan
+        auto timeScans = [&](const auto& fn, float range, size_t beamsN, std::vector<float>& dists) {
+            double bestUS = 1e30;
+            for (size_t k = 0; k < 3; ++k)
+            {
+                std::fill(dists.begin(), dists.end(), range);
+                const auto t0 = ut::GetSteadyTimeS();
+                for (size_t i = 0; i < poss.size(); ++i) fn(poss[i], range, beamsN, &dists[i * beamsN]);
+                bestUS = std::min(bestUS, (ut::GetSteadyTimeS() - t0) * 1e6 / (double)poss.size());
+            }
+            return bestUS;
+        };
+
+        bool pass = true;
+        for (const float range : {20.f, 40.f})
+            for (const size_t beamsN : {32, 64, 128})
+            {
+                std::vector<float> rayDists(poss.size() * beamsN);
+                std::vector<float> lidDists(poss.size() * beamsN);
+                const auto raysUS  = timeScans(scanRays, range, beamsN, rayDists);
+                const auto lidarUS = timeScans(scanLidar, range, beamsN, lidDists);
+                const auto refN    = poss.size() / 20;
+                std::vector<float> refDists(refN * beamsN, range);
+                for (size_t i = 0; i < refN; ++i) scanMarch(poss[i], range, beamsN, &refDists[i * beamsN]);
+
+                size_t exactN = 0;
+                for (size_t i = 0; i < refN * beamsN; ++i)
+                    exactN += std::abs(lidDists[i] - refDists[i]) < 1e-3f ? 1 : 0;
+                const auto exactFrac = (double)exactN / (double)(refN * beamsN);
+
+                const auto ok = lidarUS < raysUS && exactFrac >= LIDAR_MIN_EXACT_FRAC;
+                checkLog("Lidar, %zu beams up to %.0f m: %.2f us with a ScanRay() per beam, %.2f us with ScanLidar(), "
+                         "%.2f%% of the beams as the march (tol %.1f%%) %s",
+                         beamsN, range, raysUS, lidarUS, exactFrac * 100, LIDAR_MIN_EXACT_FRAC * 100,
+                         ok ? "OK" : "FAIL");
+                pass = pass && ok;
+            }
+        return pass;
+    }
+
+    //==================================================================
+    // Model 1 steady state: the list of the best keeps more than the last one evaluated, in order
+    static bool check_M1SteadyState()
+    {
+        CS_M1_Train train(CS_SENS_N, CS_CTRL_N);
+
+        const size_t EVALS_N = 40;
+        std::mt19937 rng(1);
+        std::uniform_real_distribution<double> uni(0.0, 100.0);
+        double minCost = 1e30;
+        for (size_t i = 0; i < EVALS_N; ++i)
+        {
+            CS_ChromoInfo info;
+            info.ci_cost   = uni(rng);
+            info.ci_popIdx = i;
+            minCost        = std::min(minCost, info.ci_cost);
+            train.OnChromoEvaluated(train.MakeOffspring(i), info);
+        }
+
+        size_t listN     = 0;
+        bool isSorted    = true;
+        double firstCost = 0;
+        train.LockViewBestChromos([&](const auto& chromos, const auto& infos) {
+            listN     = std::min(chromos.size(), infos.size());
+            firstCost = infos.empty() ? 0 : infos[0].ci_cost;
+            for (size_t i = 1; i < infos.size(); ++i)
+                isSorted = isSorted && !CS_ChromoInfo::IsBetter(infos[i], infos[i - 1]);
+        });
+
+        const auto ok = listN > 1 && isSorted && firstCost == minCost;
+        checkLog("M1 steady state, %zu evaluations: %zu best listed, %s, best cost %g (expected %g) %s", EVALS_N,
+                 listN, isSorted ? "sorted" : "NOT sorted", firstCost, minCost, ok ? "OK" : "FAIL");
+        return ok;
+    }
+
+    //==================================================================
+    bool RunChecks()
+    {
+        const std::vector<std::pair<const char*, std::function<bool()>>> checks = {
+            {"Novelty archive", check_NoveltyArchive},
+            {"Brain batch", check_BrainBatch},
+            {"Sim parallel", check_SimParallel},
+            {"Trajectory recorder", check_TrajRecorder},
+            {"Integrator", check_Integrator},
+            {"Lidar", check_Lidar},
+            {"M1 steady state", check_M1SteadyState},
+        };
+
+        size_t failedN = 0;
+        for (const auto& [pName, fn] : checks)
+        {
+            const auto pass = fn();
+            failedN += pass ? 0 : 1;
+            checkLog("%s: %s", pName, pass ? "PASSED" : "FAILED");
+        }
+        checkLog("%zu of %zu checks passed", checks.size() - failedN, checks.size());
+        return !failedN;
+    }
+} // namespace CS_Checks
@@ -0,0 +1,12 @@
+#ifndef CS_CHECKS_H
+#define CS_CHECKS_H
+
+// measurements behind the claims of the trickier parts of the code (accuracy and speed), run with --checks
+// each check logs what it measured, and fails if it's out of the tolerance it states
+namespace CS_Checks
+{
+    // true if all the checks passed
+    bool RunChecks();
+} // namespace CS_Checks
+
+#endif
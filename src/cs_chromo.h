@@ -1,12 +1,14 @@
 #ifndef CS_CHROMO_H
 #define CS_CHROMO_H
 
+#include <array>
 #include <cstring>
 #include <memory>
 #include <sstream>
 #include <string>
 #include <utility>
 #include <vector>
+#include "cs_hash.h"
 
 class CS_Chromo
 {
@@ -51,12 +53,13 @@ class CS_Chromo
         mChromoBytes.reserve(sizeBytes);
     }
 
-    // make a C++ std::hash of the vector
-    uint64_t ToHash() const
+    // 64 bit hash of the chromosome data
+    uint64_t ToHash(uint64_t seed = 0) const { return CS_HashBytes64(mChromoBytes.data(), mChromoBytes.size(), seed); }
+
+    // 128 bit hash, as two differently seeded 64 bit hashes
+    std::array<uint64_t, 2> ToHash128(uint64_t seed = 0) const
     {
-        uint64_t h = 0;
-        for (auto& v : mChromoBytes) h ^= std::hash<uint8_t>()(v) + 0x9e3779b9 + (h << 6) + (h >> 2);
-        return h;
+        return {ToHash(seed), ToHash(seed ^ 0x9E3779B97F4A7C15ULL)};
     }
 
     std::string ToHashHex() const
@@ -0,0 +1,84 @@
+#ifndef CS_FITNESSCACHE_H
+#define CS_FITNESSCACHE_H
+
+#include <array>
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+#include "cs_chromo.h"
+#include "cs_novelty.h"
+
+// cache of the evaluated costs, keyed by the chromosome and the scenario it was evaluated on
+class CS_FitnessCache
+{
+  public:
+    using Key = std::array<uint64_t, 2>;
+
+  private:
+    struct KeyHash
+    {
+        size_t operator()(const Key& k) const { return (size_t)(k[0] ^ (k[1] * 0x9E3779B97F4A7C15ULL)); }
+    };
+
+    const size_t mMaxEntriesN;
+    const uint64_t mFingerprint;
+
+    std::mutex mMutex;
+    struct Entry
+    {
+        double cost{};
+        CS_BehaviorDesc desc;
+    };
+    std::unordered_map<Key, Entry, KeyHash> mCosts;
+    std::deque<Key> mInsertOrder;
+
+    std::atomic<size_t> mHitsN{};
+    std::atomic<size_t> mMissesN{};
+
+  public:
+    CS_FitnessCache(uint64_t fingerprint, size_t maxEntriesN = 1000000)
+        : mMaxEntriesN(maxEntriesN), mFingerprint(fingerprint)
+    {
+    }
+
+    // the variant distinguishes different evaluations of the same scenario (e.g. shorter ones)
+    Key MakeKey(const CS_Chromo& chromo, uint64_t variant = 0) const
+    {
+        return chromo.ToHash128(mFingerprint ^ variant);
+    }
+
+    bool FindCost(const Key& key, double& out_cost, CS_BehaviorDesc* pOutDesc = nullptr)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (auto it = mCosts.find(key); it != mCosts.end())
+        {
+            out_cost = it->second.cost;
+            if (pOutDesc) *pOutDesc = it->second.desc;
+            ++mHitsN;
+            return true;
+        }
+        ++mMissesN;
+        return false;
+    }
+
+    void StoreCost(const Key& key, double cost, const CS_BehaviorDesc& desc = {})
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (!mCosts.emplace(key, Entry{cost, desc}).second) return;
+
+        // drop the oldest entries
+        mInsertOrder.push_back(key);
+        while (mInsertOrder.size() > mMaxEntriesN)
+        {
+            mCosts.erase(mInsertOrder.front());
+            mInsertOrder.pop_front();
+        }
+    }
+
+    size_t GetHitsN() const { return mHitsN; }
+
+    size_t GetMissesN() const { return mMissesN; }
+};
+
+#endif
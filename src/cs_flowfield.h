@@ -0,0 +1,100 @@
+#ifndef CS_FLOWFIELD_H
+#define CS_FLOWFIELD_H
+
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <queue>
+#include <utility>
+#include <vector>
+
+// shortest paths to a target cell, around the walls of a height grid
+// built once with a grid Dijkstra (8 neighbors, no cutting of wall corners), then looked up in O(1)
+class CS_FlowField
+{
+    // straight ones first, opposites are paired (i ^ 1)
+    static constexpr int NEIGHS_N           = 8;
+    static constexpr int NEIGH_DX[NEIGHS_N] = {1, -1, 0, 0, 1, -1, 1, -1};
+    static constexpr int NEIGH_DZ[NEIGHS_N] = {0, 0, 1, -1, 1, -1, -1, 1};
+
+    const size_t mSizX;
+    const size_t mSizZ;
+    const float mCellSize;
+
+    std::vector<float> mDists;  // meters to the target, < 0 if unreachable
+    std::vector<int8_t> mNexts; // neighbor index of the next cell on the path, < 0 if none
+
+  public:
+    // heights indexed as x + z * sizX, cells above wallHeight can't be crossed
+    CS_FlowField(const float* pHeights, size_t sizX, size_t sizZ, float cellSize, float wallHeight, int targetX,
+                 int targetZ)
+        : mSizX(sizX), mSizZ(sizZ), mCellSize(cellSize), mDists(sizX * sizZ, -1.f), mNexts(sizX * sizZ, -1)
+    {
+        build(pHeights, wallHeight, targetX, targetZ);
+    }
+
+    // geodesic distance in meters, < 0 if the cell is a wall or can't reach the target
+    float GetDist(int x, int z) const { return isInside(x, z) ? mDists[toIdx(x, z)] : -1.f; }
+
+    // unit direction (x, z) towards the next cell of the path, zero if none
+    std::pair<float, float> GetDir(int x, int z) const
+    {
+        const auto ni = isInside(x, z) ? mNexts[toIdx(x, z)] : (int8_t)-1;
+        if (ni < 0) return {0.f, 0.f};
+
+        const auto oolen = (ni < 4) ? 1.f : 0.70710678f;
+        return {(float)NEIGH_DX[ni] * oolen, (float)NEIGH_DZ[ni] * oolen};
+    }
+
+  private:
+    bool isInside(int x, int z) const { return x >= 0 && z >= 0 && (size_t)x < mSizX && (size_t)z < mSizZ; }
+
+    size_t toIdx(int x, int z) const { return (size_t)x + (size_t)z * mSizX; }
+
+    void build(const float* pHeights, float wallHeight, int targetX, int targetZ)
+    {
+        auto isFree = [&](int x, int z) { return isInside(x, z) && pHeights[toIdx(x, z)] <= wallHeight; };
+
+        if (!isFree(targetX, targetZ)) return;
+
+        // in cell units while building
+        const float stepLens[NEIGHS_N] = {1, 1, 1, 1, 1.41421356f, 1.41421356f, 1.41421356f, 1.41421356f};
+
+        using Item = std::pair<float, size_t>;
+        std::priority_queue<Item, std::vector<Item>, std::greater<Item>> que;
+
+        mDists[toIdx(targetX, targetZ)] = 0;
+        que.push({0.f, toIdx(targetX, targetZ)});
+        while (!que.empty())
+        {
+            const auto [d, idx] = que.top();
+            que.pop();
+            if (d > mDists[idx]) continue; // stale
+
+            const auto x = (int)(idx % mSizX);
+            const auto z = (int)(idx / mSizX);
+            for (int ni = 0; ni < NEIGHS_N; ++ni)
+            {
+                const auto nx = x + NEIGH_DX[ni];
+                const auto nz = z + NEIGH_DZ[ni];
+                if (!isFree(nx, nz)) continue;
+                // diagonals only if both sides are free
+                if (ni >= 4 && (!isFree(nx, z) || !isFree(x, nz))) continue;
+
+                const auto nidx = toIdx(nx, nz);
+                const auto nd   = d + stepLens[ni];
+                if (mDists[nidx] >= 0 && mDists[nidx] <= nd) continue;
+
+                mDists[nidx] = nd;
+                // from the neighbor, the path goes back the opposite way
+                mNexts[nidx] = (int8_t)(ni ^ 1);
+                que.push({nd, nidx});
+            }
+        }
+
+        for (auto& d : mDists)
+            if (d > 0) d *= mCellSize;
+    }
+};
+
+#endif
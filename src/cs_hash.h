@@ -0,0 +1,71 @@
+#ifndef CS_HASH_H
+#define CS_HASH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+// 64 bit hash of a block of memory (same scheme as xxHash64)
+// the main loop works on 4 independent 64 bit lanes, 32 bytes at a time, so that
+// the compiler can keep them in flight in parallel
+inline uint64_t CS_HashBytes64(const void* pData, size_t size, uint64_t seed = 0)
+{
+    constexpr uint64_t P1 = 0x9E3779B185EBCA87ULL;
+    constexpr uint64_t P2 = 0xC2B2AE3D27D4EB4FULL;
+    constexpr uint64_t P3 = 0x165667B19E3779F9ULL;
+    constexpr uint64_t P4 = 0x85EBCA77C2B2AE63ULL;
+    constexpr uint64_t P5 = 0x27D4EB2F165667C5ULL;
+
+    auto rotl     = [](uint64_t x, int r) { return (x << r) | (x >> (64 - r)); };
+    auto read8    = [](const uint8_t* p) {
+        uint64_t v;
+        memcpy(&v, p, sizeof(v));
+        return v;
+    };
+    auto mixRound = [&](uint64_t acc, uint64_t in) { return rotl(acc + in * P2, 31) * P1; };
+    auto merge    = [&](uint64_t acc, uint64_t val) { return (acc ^ mixRound(0, val)) * P1 + P4; };
+
+    const auto* p   = (const uint8_t*)pData;
+    const auto* end = p + size;
+
+    uint64_t h;
+    if (size >= 32)
+    {
+        uint64_t v[4] = {seed + P1 + P2, seed + P2, seed, seed - P1};
+        for (; p + 32 <= end; p += 32)
+            for (size_t i = 0; i < 4; ++i) v[i] = mixRound(v[i], read8(p + i * 8));
+
+        h = rotl(v[0], 1) + rotl(v[1], 7) + rotl(v[2], 12) + rotl(v[3], 18);
+        for (size_t i = 0; i < 4; ++i) h = merge(h, v[i]);
+    }
+    else h = seed + P5;
+
+    h += (uint64_t)size;
+
+    // tail
+    for (; p + 8 <= end; p += 8) h = rotl(h ^ mixRound(0, read8(p)), 27) * P1 + P4;
+    if (p + 4 <= end)
+    {
+        uint32_t v;
+        memcpy(&v, p, sizeof(v));
+        h = rotl(h ^ ((uint64_t)v * P1), 23) * P2 + P3;
+        p += 4;
+    }
+    for (; p < end; ++p) h = rotl(h ^ ((uint64_t)*p * P5), 11) * P1;
+
+    // final avalanche
+    h ^= h >> 33;
+    h *= P2;
+    h ^= h >> 29;
+    h *= P3;
+    h ^= h >> 32;
+    return h;
+}
+
+inline uint64_t CS_HashString64(const std::string& str, uint64_t seed = 0)
+{
+    return CS_HashBytes64(str.data(), str.size(), seed);
+}
+
+#endif
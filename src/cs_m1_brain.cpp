@@ -112,23 +112,74 @@ template <typename T> class SimpleNN
                                [](size_t sum, const Layer& l) { return sum + l.Wei.size() + l.Bia.size(); });
     }
 
+    // define the activation function
+    static inline auto activ_vec =
+        /* sigm       */ //[](auto& v) { for (auto& x : v) x = T(1.0) / (T(1.0) + exp(-x)); };
+        /* tanh       */ //[](auto& v) { for (auto& x : v) x = tanh(x); };
+        /* relu       */ //[](auto& v) { for (auto& x : v) x = std::max(T(0), x); };
+        /* leaky_relu */ //[](auto& v) { for (auto& x : v) x = std::max(T(0.01)*x, x); };
+        /* gelu       */ [](auto& v) {
+        for (auto& x : v) x = x * T(0.5) * (T(1.0) + erf(x / sqrt(T(2.0))));
+    };
+
+    // dst = activ(src * Wei + Bia) for rowsN contiguous rows, 4 rows at a time, so that each row of weights
+    // is loaded once for 4 rows of inputs and the inner loop runs along it (the sums are in the same order as
+    // CSM_Vec_mul_Mat, so the outputs match ForwardPass)
+    static void layerRows(T* pDst, const T* pSrc, size_t rowsN, const Layer& l)
+    {
+        const auto insN  = l.Wei.size_rows();
+        const auto outsN = l.Wei.size_cols();
+        std::fill(pDst, pDst + rowsN * outsN, T(0));
+
+        size_t r = 0;
+        for (; r + 4 <= rowsN; r += 4)
+        {
+            const auto* pS = pSrc + r * insN;
+            auto* pD0      = pDst + r * outsN;
+            auto* pD1      = pD0 + outsN;
+            auto* pD2      = pD1 + outsN;
+            auto* pD3      = pD2 + outsN;
+            for (size_t j = 0; j < insN; ++j)
+            {
+                const auto* pW = l.Wei[j];
+                const auto a0  = pS[j];
+                const auto a1  = pS[insN + j];
+                const auto a2  = pS[insN * 2 + j];
+                const auto a3  = pS[insN * 3 + j];
+                for (size_t c = 0; c < outsN; ++c)
+                {
+                    pD0[c] += a0 * pW[c];
+                    pD1[c] += a1 * pW[c];
+                    pD2[c] += a2 * pW[c];
+                    pD3[c] += a3 * pW[c];
+                }
+            }
+        }
+        for (; r < rowsN; ++r)
+        {
+            const auto* pS = pSrc + r * insN;
+            auto* pD       = pDst + r * outsN;
+            for (size_t j = 0; j < insN; ++j)
+            {
+                const auto* pW = l.Wei[j];
+                for (size_t c = 0; c < outsN; ++c) pD[c] += pS[j] * pW[c];
+            }
+        }
+
+        for (r = 0; r < rowsN; ++r)
+        {
+            Vec d(pDst + r * outsN, outsN);
+            d += l.Bia;
+        }
+        Vec all(pDst, rowsN * outsN);
+        activ_vec(all);
+    }
+
   public:
     void ForwardPass(Vec& outs, const Vec& ins)
     {
         assert(ins.size() == mLs[0].Wei.size_rows() && outs.size() == mLs.back().Wei.size_cols());
 
-        // define the activation function
-        auto activ_vec =
-            /* sigm       */ //[](auto& v) { for (auto& x : v) x = T(1.0) / (T(1.0) + exp(-x)); };
-            /* tanh       */ //[](auto& v) { for (auto& x : v) x = tanh(x); };
-            /* relu       */ //[](auto& v) { for (auto& x : v) x = std::max(T(0), x); };
-            /* leaky_relu */ //[](auto& v) { for (auto& x : v) x = std::max(T(0.01)*x, x); };
-            /* gelu       */ [](auto& v) {
-            for (auto& x : v) x = x * T(0.5) * (T(1.0) + erf(x / sqrt(T(2.0))));
-        };
-
-        // auto activ_vec = gelu_vec;
-
         auto* pTempMem0 = (T*)alloca(mMaxLenVecN * sizeof(T));
         auto* pTempMem1 = (T*)alloca(mMaxLenVecN * sizeof(T));
 
@@ -156,6 +207,30 @@ template <typename T> class SimpleNN
             activ_vec(outs);
         }
     }
+
+    // ForwardPass on n contiguous rows, a layer at a time over blocks of rows
+    void ForwardPassBatch(size_t n, const T* pIns, size_t insN, T* pOuts, size_t outsN)
+    {
+        assert(insN == mLs[0].Wei.size_rows() && outsN == mLs.back().Wei.size_cols());
+
+        constexpr size_t BLOCK_N = 32;
+
+        auto* pTempMem0 = (T*)alloca(BLOCK_N * mMaxLenVecN * sizeof(T));
+        auto* pTempMem1 = (T*)alloca(BLOCK_N * mMaxLenVecN * sizeof(T));
+
+        for (size_t sta = 0; sta < n; sta += BLOCK_N)
+        {
+            const auto rowsN = std::min(BLOCK_N, n - sta);
+            const auto* pSrc = pIns + sta * insN;
+            for (size_t i = 0; i < mLs.size(); ++i)
+            {
+                auto* pDst = (i == mLs.size() - 1) ? pOuts + sta * outsN : pTempMem0;
+                layerRows(pDst, pSrc, rowsN, mLs[i]);
+                pSrc = pDst;
+                std::swap(pTempMem0, pTempMem1);
+            }
+        }
+    }
 };
 
 template class SimpleNN<CS_SCALAR>;
@@ -195,3 +270,8 @@ void CS_M1_Brain::AnimateBrain(const CSM_Vec& ins, CSM_Vec& outs) const
 {
     moNN->ForwardPass(outs, ins);
 }
+
+void CS_M1_Brain::AnimateBrainBatch(size_t n, const CS_SCALAR* pIns, size_t insN, CS_SCALAR* pOuts, size_t outsN) const
+{
+    moNN->ForwardPassBatch(n, pIns, insN, pOuts, outsN);
+}
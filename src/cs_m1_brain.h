@@ -19,6 +19,7 @@ class CS_M1_Brain : public CS_BrainBase
     CS_Chromo MakeBrainChromo() const override;
 
     void AnimateBrain(const CSM_Vec& ins, CSM_Vec& outs) const override;
+    void AnimateBrainBatch(size_t n, const CS_SCALAR* pIns, size_t insN, CS_SCALAR* pOuts, size_t outsN) const override;
 };
 
 #endif
@@ -1,13 +1,17 @@
 #ifndef CS_M1_TRAIN_H
 #define CS_M1_TRAIN_H
 
+#include <atomic>
 #include <functional>
 #include <memory>
 #include <mutex>
 #include <random>
 #include <vector>
+#include "log/log.h"
 #include "cs_m1_brain.h"
 #include "cs_m1_types.h"
+#include "cs_surrogate.h"
+#include "cs_threadpool.h"
 #include "cs_trainbase.h"
 
 static auto uniformCrossOver = [](auto& rng, const auto& a, const auto& b) {
@@ -97,14 +101,32 @@ class CS_M1_Train : public CS_TrainBase
     static constexpr size_t INIT_POP_N          = 100;
     static constexpr size_t TOP_FOR_SELECTION_N = 10;
     static constexpr size_t TOP_FOR_REPORT_N    = 10;
+    // with mUseSurrogate, the offspring are pre-screened and only the most promising get evaluated
+    static constexpr size_t SURR_MIN_SAMPLES_N  = 200;  // before the surrogate is trusted
+    static constexpr size_t SURR_OVERSAMPLE_N   = 3;    // offspring bred for each one kept
+    static constexpr double SURR_EXPLORE_FRAC   = 0.2;  // of those kept, picked at random
 
     // best chromos list just for display
     std::mutex mBestChromosMutex;
     std::vector<CS_Chromo> mBestChromos;
     std::vector<CS_ChromoInfo> mBestCInfos;
 
+    // distinguishes the instances (i.e. islands), so that they don't start from the same population
+    const size_t mInstanceIdx;
+
+    CS_Surrogate<CS_M1_ChromoScalar> mSurrogate;
+    double mSurrHorizonFrac{-1}; // of the samples in the surrogate
+    std::atomic<double> mSurrRankCorr{std::numeric_limits<double>::quiet_NaN()};
+
+    // parents for the steady-state offspring (only used by the trainer's thread)
+    std::vector<CS_Chromo> mEliteChromos;
+    std::vector<CS_ChromoInfo> mEliteCInfos;
+
   public:
-    CS_M1_Train(size_t insN, size_t outsN) : CS_TrainBase(insN, outsN) {}
+    CS_M1_Train(size_t insN, size_t outsN, size_t instanceIdx = 0)
+        : CS_TrainBase(insN, outsN), mInstanceIdx(instanceIdx)
+    {
+    }
 
     ~CS_M1_Train() override = default;
 
@@ -113,6 +135,11 @@ class CS_M1_Train : public CS_TrainBase
         return std::make_unique<CS_M1_Brain>(chromo, mInsN, mOutsN);
     }
 
+    bool HasSelfContainedChromos() const override { return true; }
+
+    // OnEpochEnd() also pairs with the one right after the top N
+    size_t GetSelectionN() const override { return TOP_FOR_SELECTION_N + 1; }
+
     // initial list of chromosomes
     vector<CS_Chromo> MakeStartChromos() override
     {
@@ -120,7 +147,7 @@ class CS_M1_Train : public CS_TrainBase
         for (size_t i = 0; i < INIT_POP_N; ++i)
         {
             // make a temp brain from a random seed
-            CS_M1_Brain brain((uint32_t)i, mInsN, mOutsN);
+            CS_M1_Brain brain((uint32_t)(mInstanceIdx * INIT_POP_N + i), mInsN, mOutsN);
             // store the brain's chromo
             chromos.push_back(brain.MakeBrainChromo());
         }
@@ -136,41 +163,104 @@ class CS_M1_Train : public CS_TrainBase
         for (size_t i = 0; i < n; ++i) pSorted.push_back({pChromos + i, pInfos + i});
 
         std::sort(pSorted.begin(), pSorted.end(),
-                  [](const auto& a, const auto& b) { return a.second->ci_cost < b.second->ci_cost; });
+                  [](const auto& a, const auto& b) { return CS_ChromoInfo::IsBetter(*a.second, *b.second); });
 
         // update the list of best chromosomes (with a lock... we're in a different thread)
         updateBestChromosList(pSorted);
 
-        // random generator
-        const auto seed = (unsigned int)epochIdx;
-        std::mt19937 rng(seed);
-        std::uniform_real_distribution<double> dist(0.0, 1.0);
+        if (mUseSurrogate) trainSurrogate(epochIdx, pChromos, pInfos, n);
 
         // mutation function
-        auto mutateChromo = [&](const CS_Chromo& chromo) {
+        auto mutateChromo = [](auto& rng, const CS_Chromo& chromo) {
             // return mutateScaled(rng, chromo, (CS_SCALAR)0.2);
             return mutateNormalDist(rng, chromo, (CS_SCALAR)0.1);
         };
 
-        std::vector<CS_Chromo> newChromos;
+        // list the offspring to make: pairs of parents and whether to mutate
+        struct Recipe
+        {
+            const CS_Chromo* pA{};
+            const CS_Chromo* pB{};
+            bool doMutate{};
+        };
+        std::vector<Recipe> recipes;
         // breed the top N among each other with some mutations
         for (size_t i = 0; i < TOP_FOR_SELECTION_N; ++i)
         {
-            const auto& c_i = *pSorted[i].first;
+            const auto* c_i = pSorted[i].first;
             for (size_t j = i + 2; j < TOP_FOR_SELECTION_N; ++j)
             {
-                const auto& c_j = *pSorted[j].first;
-                newChromos.push_back(uniformCrossOver(rng, c_i, c_j));
-                newChromos.push_back(mutateChromo(uniformCrossOver(rng, c_i, c_j)));
-                const auto& c_k = *pSorted[j + 1].first;
-                newChromos.push_back(uniformCrossOver(rng, c_i, c_k));
-                newChromos.push_back(mutateChromo(uniformCrossOver(rng, c_i, c_k)));
+                const auto* c_j = pSorted[j].first;
+                recipes.push_back({c_i, c_j, false});
+                recipes.push_back({c_i, c_j, true});
+                const auto* c_k = pSorted[j + 1].first;
+                recipes.push_back({c_i, c_k, false});
+                recipes.push_back({c_i, c_k, true});
             }
         }
 
+        // breed more than needed, the surrogate will pick
+        const auto keepN  = recipes.size();
+        const auto useSur = mUseSurrogate && mSurrogate.GetSamplesN() >= SURR_MIN_SAMPLES_N;
+        if (useSur)
+            for (size_t k = 1; k < SURR_OVERSAMPLE_N; ++k)
+                for (size_t i = 0; i < keepN; ++i) recipes.push_back(recipes[i]);
+
+        // breed in parallel, each offspring with its own random stream, so that
+        // the result doesn't depend on the number of threads
+        std::vector<CS_Chromo> newChromos(recipes.size());
+        CS_ParallelFor(recipes.size(), mWorkersN, [&](size_t idx) {
+            auto rng        = makeOffspringRNG(epochIdx, idx);
+            const auto& r   = recipes[idx];
+            auto child      = uniformCrossOver(rng, *r.pA, *r.pB);
+            newChromos[idx] = r.doMutate ? mutateChromo(rng, child) : std::move(child);
+        });
+
+        if (useSur) return screenOffspring(epochIdx, newChromos, keepN);
+
         return newChromos;
     }
 
+    bool SupportsSteadyState() const override { return true; }
+
+    // when a single chromosome has been evaluated (steady-state mode)
+    void OnChromoEvaluated(const CS_Chromo& chromo, const CS_ChromoInfo& info) override
+    {
+        auto it = std::lower_bound(mEliteCInfos.begin(), mEliteCInfos.end(), info, CS_ChromoInfo::IsBetter);
+        if (const auto idx = (size_t)(it - mEliteCInfos.begin()); idx < TOP_FOR_SELECTION_N)
+        {
+            mEliteChromos.insert(mEliteChromos.begin() + (ptrdiff_t)idx, chromo);
+            mEliteCInfos.insert(mEliteCInfos.begin() + (ptrdiff_t)idx, info);
+            if (mEliteCInfos.size() > TOP_FOR_SELECTION_N)
+            {
+                mEliteChromos.pop_back();
+                mEliteCInfos.pop_back();
+            }
+        }
+
+        updateBestChromosList({{&chromo, &info}});
+    }
+
+    // a new chromosome bred from two of the elite, with the same operators as OnEpochEnd()
+    CS_Chromo MakeOffspring(size_t offspringIdx) override
+    {
+        auto rng = makeOffspringRNG(0, offspringIdx);
+
+        const auto n = mEliteChromos.size();
+        // nothing evaluated yet, start from a random brain
+        if (!n) return CS_M1_Brain((uint32_t)rng(), mInsN, mOutsN).MakeBrainChromo();
+
+        std::uniform_int_distribution<size_t> pick(0, n - 1);
+        const auto ia = pick(rng);
+        auto ib       = pick(rng);
+        if (n > 1)
+            while (ib == ia) ib = pick(rng);
+
+        auto child = uniformCrossOver(rng, mEliteChromos[ia], mEliteChromos[ib]);
+        // half mutated, as in the epoch recipes
+        return (rng() & 1) ? mutateNormalDist(rng, child, (CS_SCALAR)0.1) : child;
+    }
+
     void LockViewBestChromos(
         const std::function<void(const std::vector<CS_Chromo>&, const std::vector<CS_ChromoInfo>&)>& func) override
     {
@@ -178,21 +268,96 @@ class CS_M1_Train : public CS_TrainBase
         func(mBestChromos, mBestCInfos);
     }
 
+    double GetSurrogateRankCorr() const override { return mSurrRankCorr; }
+
   private:
+    // random generator for a given offspring of a given epoch
+    std::mt19937 makeOffspringRNG(size_t epochIdx, size_t offspringIdx) const
+    {
+        std::seed_seq seq{(uint32_t)epochIdx,     (uint32_t)((uint64_t)epochIdx >> 32),
+                          (uint32_t)offspringIdx, (uint32_t)((uint64_t)offspringIdx >> 32),
+                          (uint32_t)mInstanceIdx};
+        return std::mt19937(seq);
+    }
+
+    // learn from the epoch's costs, after checking how well they were predicted
+    void trainSurrogate(size_t epochIdx, const CS_Chromo* pChromos, const CS_ChromoInfo* pInfos, size_t n)
+    {
+        // only the costs of the longest horizon and the highest fidelity are comparable
+        double maxHor = 0;
+        for (size_t i = 0; i < n; ++i) maxHor = std::max(maxHor, pInfos[i].ci_horizonFrac);
+        size_t maxFid = 0;
+        for (size_t i = 0; i < n; ++i)
+            if (pInfos[i].ci_horizonFrac == maxHor) maxFid = std::max(maxFid, pInfos[i].ci_fidelity);
+
+        // nor are those of the epochs before the horizon grew
+        if (maxHor != mSurrHorizonFrac)
+        {
+            mSurrogate.ClearSamples();
+            mSurrHorizonFrac = maxHor;
+            mSurrRankCorr    = std::numeric_limits<double>::quiet_NaN();
+        }
+
+        std::vector<double> preds;
+        std::vector<double> costs;
+        const auto doCheck = mSurrogate.GetSamplesN() >= SURR_MIN_SAMPLES_N;
+        for (size_t i = 0; i < n; ++i)
+        {
+            // comparable and exact (an early stop only tells that the cost is above the bound)
+            if (pInfos[i].ci_horizonFrac != maxHor || pInfos[i].ci_fidelity != maxFid || pInfos[i].ci_isCostLowBound)
+                continue;
+            if (doCheck)
+            {
+                preds.push_back(mSurrogate.PredictCost(pChromos[i]));
+                costs.push_back(pInfos[i].ci_cost);
+            }
+            mSurrogate.AddSample(pChromos[i], pInfos[i].ci_cost);
+        }
+
+        if (doCheck)
+        {
+            mSurrRankCorr = CS_Surrogate<CS_M1_ChromoScalar>::CalcRankCorrelation(preds, costs);
+            LOGGER(logging::INFO) << "Epoch " << epochIdx << ", surrogate rank correlation: " << mSurrRankCorr;
+        }
+    }
+
+    // keep the keepN offspring with the lowest predicted cost, except for a quota picked at random,
+    // so that the surrogate can't narrow the search to what it already knows
+    std::vector<CS_Chromo> screenOffspring(size_t epochIdx, std::vector<CS_Chromo>& chromos, size_t keepN) const
+    {
+        std::vector<double> preds(chromos.size());
+        CS_ParallelFor(chromos.size(), mWorkersN,
+                       [&](size_t idx) { preds[idx] = mSurrogate.PredictCost(chromos[idx]); });
+
+        std::vector<size_t> order(chromos.size());
+        for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+        std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return preds[a] < preds[b]; });
+
+        keepN             = std::min(keepN, order.size());
+        const auto explN  = (size_t)((double)keepN * SURR_EXPLORE_FRAC);
+        const auto bestN  = keepN - explN;
+
+        // the exploration quota, from those that didn't make it
+        auto rng          = makeOffspringRNG(epochIdx, (size_t)-1);
+        std::shuffle(order.begin() + (ptrdiff_t)bestN, order.end(), rng);
+
+        std::vector<CS_Chromo> kept;
+        kept.reserve(keepN);
+        for (size_t i = 0; i < keepN; ++i) kept.push_back(std::move(chromos[order[i]]));
+        return kept;
+    }
+
     void updateBestChromosList(const std::vector<std::pair<const CS_Chromo*, const CS_ChromoInfo*>>& pSorted)
     {
         std::lock_guard<std::mutex> lock(mBestChromosMutex);
 
-        const auto n = std::min(TOP_FOR_REPORT_N, pSorted.size());
-
         // append the new best chromos to the list
         for (size_t i = 0; i < pSorted.size(); ++i)
         {
-            const auto cost = pSorted[i].second->ci_cost;
+            const auto& info = *pSorted[i].second;
 
             // find the insertion point in the mBestCInfos list
-            auto it         = std::lower_bound(mBestCInfos.begin(), mBestCInfos.end(), cost,
-                                               [](const auto& a, const auto& b) { return a.ci_cost < b; });
+            auto it          = std::lower_bound(mBestCInfos.begin(), mBestCInfos.end(), info, CS_ChromoInfo::IsBetter);
 
             // insert at the given index
             if (const auto idx = (size_t)(it - mBestCInfos.begin()); idx < TOP_FOR_REPORT_N)
@@ -201,10 +366,12 @@ class CS_M1_Train : public CS_TrainBase
                 mBestCInfos.insert(mBestCInfos.begin() + (ptrdiff_t)idx, *pSorted[i].second);
             }
         }
+        const auto n = std::min(TOP_FOR_REPORT_N, mBestCInfos.size());
         mBestChromos.resize(n);
         mBestCInfos.resize(n);
 #ifdef DEBUG // verify that they are all sorted
-        for (size_t i = 1; i < mBestCInfos.size(); ++i) assert(mBestCInfos[i - 1].ci_cost <= mBestCInfos[i].ci_cost);
+        for (size_t i = 1; i < mBestCInfos.size(); ++i)
+            assert(!CS_ChromoInfo::IsBetter(mBestCInfos[i], mBestCInfos[i - 1]));
 #endif
     }
 };
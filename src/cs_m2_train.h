@@ -9,6 +9,7 @@
 #include "log/log.h"
 #include "ann_mlp_ga_v1.h"
 #include "cs_m2_brain.h"
+#include "cs_trace.h"
 #include "cs_trainbase.h"
 #include "cs_math.h"
 
@@ -28,9 +29,13 @@ class CS_M2_Train : public CS_TrainBase
 
     std::unique_ptr<nn::ANN_MLP_GA<CS_SCALAR>> mNN;
 
+    // distinguishes the instances (i.e. islands), so that they don't start from the same population
+    // nor save to the same file
+    const size_t mInstanceIdx;
+
   public:
-    CS_M2_Train(size_t insN, size_t outsN)
-        : CS_TrainBase(insN, outsN)
+    CS_M2_Train(size_t insN, size_t outsN, size_t instanceIdx = 0)
+        : CS_TrainBase(insN, outsN), mInstanceIdx(instanceIdx)
     {
 #ifdef CS_M2_TRAIN_USE_HDF5_CONFIG
         if (!std::filesystem::exists(CONFIGFILE))
@@ -69,11 +74,14 @@ class CS_M2_Train : public CS_TrainBase
             nnsize.push_back(nnsizeH[i]);
         nnsize.push_back(mOutsN);
 #endif
-        // create save directory if not exists
+        // create save directory if not exists (the islands may race to it)
         if (bSavePeriodic)
-            if (!std::filesystem::exists(sSavePath)) std::filesystem::create_directory(sSavePath);
+        {
+            std::error_code ec;
+            std::filesystem::create_directory(sSavePath, ec);
+        }
 
-        mNN = std::make_unique<nn::ANN_MLP_GA<CS_SCALAR>>(nnsize, seed, nPop, nTop, nn::TANH);
+        mNN = std::make_unique<nn::ANN_MLP_GA<CS_SCALAR>>(nnsize, seed + (int)mInstanceIdx, nPop, nTop, nn::TANH);
         mNN->SetName("pathfinder");
         mNN->SetMixed(false);
         mNN->CreatePopulation();
@@ -108,7 +116,7 @@ class CS_M2_Train : public CS_TrainBase
         for (size_t i = 0; i < n; ++i) pSorted.push_back({pChromos + i, pInfos + i});
 
         std::sort(pSorted.begin(), pSorted.end(),
-                  [](const auto& a, const auto& b) { return a.second->ci_cost < b.second->ci_cost; });
+                  [](const auto& a, const auto& b) { return CS_ChromoInfo::IsBetter(*a.second, *b.second); });
 
         // update the list of best chromosomes (with a lock... we're in a different thread)
         updateBestChromosList(pSorted);
@@ -132,8 +140,11 @@ class CS_M2_Train : public CS_TrainBase
         if (bSavePeriodic)
             if (!(epochIdx % nPeriod))
             {
-                const std::string fname =
-                    sSavePath + sSaveName + (bSaveOverwrite ? "" : "_" + std::to_string(epochIdx)) + ".hd5";
+                CS_TRACE_SCOPE("HDF5 save");
+                // one file per island, as each saves from its own thread at the same epochs
+                const std::string fname = sSavePath + sSaveName +
+                                          (mInstanceIdx ? "_isl" + std::to_string(mInstanceIdx) : "") +
+                                          (bSaveOverwrite ? "" : "_" + std::to_string(epochIdx)) + ".hd5";
                 mNN->Serialize(fname);
             }
 
@@ -0,0 +1,191 @@
+#ifndef CS_M3_TRAIN_H
+#define CS_M3_TRAIN_H
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <vector>
+#include "cs_m1_brain.h"
+#include "cs_m1_types.h"
+#include "cs_trainbase.h"
+
+// a candidate of the evolution strategy: the current center plus a slice of the shared noise table
+// the brain is a Model 1 brain, materialized from the center and the noise when needed
+struct CS_M3_ChromoData
+{
+    uint32_t mNoiseOffset{};
+    int32_t mSign{}; // +1 or -1 for the antithetic pair, 0 for the center itself
+};
+
+// evolution strategies (OpenAI-ES style), with antithetic sampling and a shared Gaussian noise table
+class CS_M3_Train : public CS_TrainBase
+{
+    static constexpr size_t PAIRS_N          = 50;
+    static constexpr size_t TOP_FOR_REPORT_N = 10;
+    static constexpr size_t NOISE_TABLE_N    = (size_t)1 << 23;
+    static constexpr CS_SCALAR SIGMA         = (CS_SCALAR)0.05;
+    static constexpr CS_SCALAR LEARN_RATE    = (CS_SCALAR)0.03;
+    static constexpr CS_SCALAR MOMENTUM      = (CS_SCALAR)0.9;
+
+    // distinguishes the instances (i.e. islands)
+    const size_t mInstanceIdx;
+
+    // center of the distribution (Model 1 weights) and its momentum
+    std::vector<CS_M1_ChromoScalar> mCenter;
+    std::vector<CS_M1_ChromoScalar> mVelocity;
+
+    // best chromos list just for display (materialized, Model 1 format)
+    std::mutex mBestChromosMutex;
+    std::vector<CS_Chromo> mBestChromos;
+    std::vector<CS_ChromoInfo> mBestCInfos;
+
+  public:
+    CS_M3_Train(size_t insN, size_t outsN, size_t instanceIdx = 0)
+        : CS_TrainBase(insN, outsN), mInstanceIdx(instanceIdx)
+    {
+        const auto chromo = CS_M1_Brain((uint32_t)(instanceIdx + 1), mInsN, mOutsN).MakeBrainChromo();
+        const auto* p     = chromo.GetChromoData<CS_M1_ChromoScalar>();
+        mCenter.assign(p, p + chromo.GetChromoDataSize<CS_M1_ChromoScalar>());
+        mVelocity.assign(mCenter.size(), 0);
+    }
+
+    ~CS_M3_Train() override = default;
+
+    unique_ptr<CS_BrainBase> CreateBrain(const CS_Chromo& chromo) override
+    {
+        return std::make_unique<CS_M1_Brain>(materialize(*chromo.GetChromoData<CS_M3_ChromoData>()), mInsN, mOutsN);
+    }
+
+    // initial list of chromosomes
+    vector<CS_Chromo> MakeStartChromos() override { return makeCandidates(0); }
+
+    // when an epoch has ended
+    vector<CS_Chromo> OnEpochEnd(size_t epochIdx, const CS_Chromo* pChromos, const CS_ChromoInfo* pInfos,
+                                 size_t n) override
+    {
+        // sort by the cost
+        std::vector<size_t> order(n);
+        for (size_t i = 0; i < n; ++i) order[i] = i;
+        std::stable_sort(order.begin(), order.end(),
+                         [&](size_t a, size_t b) { return CS_ChromoInfo::IsBetter(pInfos[a], pInfos[b]); });
+
+        updateBestChromosList(pChromos, pInfos, order);
+
+        // centered ranks of the perturbed candidates, from -0.5 (best) to +0.5 (worst)
+        std::vector<size_t> perturbed;
+        for (const auto idx : order)
+            if (pChromos[idx].GetChromoData<CS_M3_ChromoData>()->mSign) perturbed.push_back(idx);
+
+        std::vector<CS_SCALAR> utils(n, 0);
+        const auto rankDen = (CS_SCALAR)std::max((size_t)1, perturbed.size() - 1);
+        for (size_t r = 0; r < perturbed.size(); ++r) utils[perturbed[r]] = (CS_SCALAR)r / rankDen - (CS_SCALAR)0.5;
+
+        // gradient of the expected cost, as a weighted sum of the noise slices
+        const auto& noise = getNoiseTable();
+        const auto dimN   = mCenter.size();
+        std::vector<CS_SCALAR> grad(dimN, 0);
+        auto* pGrad = grad.data();
+        for (size_t i = 0; i < n; ++i)
+        {
+            const auto& cd = *pChromos[i].GetChromoData<CS_M3_ChromoData>();
+            if (!cd.mSign || !utils[i]) continue;
+
+            const auto w     = utils[i] * (CS_SCALAR)cd.mSign;
+            const auto* pEps = noise.data() + cd.mNoiseOffset;
+            for (size_t j = 0; j < dimN; ++j) pGrad[j] += w * pEps[j];
+        }
+
+        // descend, with momentum
+        const auto gradSca = (CS_SCALAR)1 / ((CS_SCALAR)std::max((size_t)1, perturbed.size()) * SIGMA);
+        for (size_t j = 0; j < dimN; ++j)
+        {
+            mVelocity[j] = MOMENTUM * mVelocity[j] + grad[j] * gradSca;
+            mCenter[j] -= LEARN_RATE * mVelocity[j];
+        }
+
+        return makeCandidates(epochIdx + 1);
+    }
+
+    void LockViewBestChromos(
+        const std::function<void(const std::vector<CS_Chromo>&, const std::vector<CS_ChromoInfo>&)>& func) override
+    {
+        std::lock_guard<std::mutex> lock(mBestChromosMutex);
+        func(mBestChromos, mBestCInfos);
+    }
+
+  private:
+    // shared by all the instances, built on first use
+    static const std::vector<CS_SCALAR>& getNoiseTable()
+    {
+        static const std::vector<CS_SCALAR> sTable = []() {
+            std::vector<CS_SCALAR> table(NOISE_TABLE_N);
+            std::mt19937 rng(1234);
+            std::normal_distribution<CS_SCALAR> nor(0, 1);
+            for (auto& x : table) x = nor(rng);
+            return table;
+        }();
+        return sTable;
+    }
+
+    // the center, followed by the antithetic pairs
+    vector<CS_Chromo> makeCandidates(size_t epochIdx) const
+    {
+        std::seed_seq seq{(uint32_t)epochIdx, (uint32_t)((uint64_t)epochIdx >> 32), (uint32_t)mInstanceIdx};
+        std::mt19937 rng(seq);
+        std::uniform_int_distribution<uint32_t> offDist(0, (uint32_t)(NOISE_TABLE_N - mCenter.size()));
+
+        vector<CS_Chromo> chromos(1 + PAIRS_N * 2);
+        chromos[0].SetChromoData(CS_M3_ChromoData{0, 0});
+        for (size_t i = 0; i < PAIRS_N; ++i)
+        {
+            const auto off = offDist(rng);
+            chromos[1 + i * 2 + 0].SetChromoData(CS_M3_ChromoData{off, +1});
+            chromos[1 + i * 2 + 1].SetChromoData(CS_M3_ChromoData{off, -1});
+        }
+        return chromos;
+    }
+
+    // the weights of the candidate, as a Model 1 chromosome
+    CS_Chromo materialize(const CS_M3_ChromoData& cd) const
+    {
+        CS_Chromo chromo;
+        chromo.SetChromoData(mCenter.data(), mCenter.size());
+        if (cd.mSign)
+        {
+            const auto sca   = SIGMA * (CS_SCALAR)cd.mSign;
+            const auto* pEps = getNoiseTable().data() + cd.mNoiseOffset;
+            auto* p          = chromo.GetChromoData<CS_M1_ChromoScalar>();
+            for (size_t j = 0; j < mCenter.size(); ++j) p[j] += sca * pEps[j];
+        }
+        return chromo;
+    }
+
+    void updateBestChromosList(const CS_Chromo* pChromos, const CS_ChromoInfo* pInfos,
+                               const std::vector<size_t>& order)
+    {
+        std::lock_guard<std::mutex> lock(mBestChromosMutex);
+
+        for (const auto idx : order)
+        {
+            const auto& info = pInfos[idx];
+
+            // find the insertion point in the mBestCInfos list
+            auto it          = std::lower_bound(mBestCInfos.begin(), mBestCInfos.end(), info, CS_ChromoInfo::IsBetter);
+
+            // sorted, so none of the rest can make it either
+            const auto insIdx = (size_t)(it - mBestCInfos.begin());
+            if (insIdx >= TOP_FOR_REPORT_N) break;
+
+            mBestChromos.insert(mBestChromos.begin() + (ptrdiff_t)insIdx,
+                                materialize(*pChromos[idx].GetChromoData<CS_M3_ChromoData>()));
+            mBestCInfos.insert(mBestCInfos.begin() + (ptrdiff_t)insIdx, info);
+        }
+        const auto n = std::min(TOP_FOR_REPORT_N, mBestCInfos.size());
+        mBestChromos.resize(n);
+        mBestCInfos.resize(n);
+    }
+};
+
+#endif
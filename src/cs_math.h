@@ -2,6 +2,7 @@
 #define CS_MATH_H
 
 #include <algorithm>
+#include <cassert>
 #include <cmath>
 #include <functional>
 #include <vector>
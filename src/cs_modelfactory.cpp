@@ -1,15 +1,16 @@
 #include "cs_m1_train.h"
 #include "cs_m2_train.h"
+#include "cs_m3_train.h"
 #include "cs_modelfactory.h"
 
 namespace CS_ModelFactory
 {
 
-    static std::vector<std::string> _sModelNames = {"Model 1", "Model 2"};
+    static std::vector<std::string> _sModelNames = {"Model 1", "Model 2", "Model 3"};
 
     size_t GetModelsN()
     {
-        return 2;
+        return 3;
     }
 
     std::string GetModelName(size_t idx)
@@ -23,16 +24,19 @@ namespace CS_ModelFactory
         {
         case 0: return std::make_unique<CS_M1_Brain>(chromo, insN, outsN);
         case 1: return std::make_unique<CS_M2_Brain>(chromo, insN, outsN);
+        // the evolution strategy hands out Model 1 chromosomes
+        case 2: return std::make_unique<CS_M1_Brain>(chromo, insN, outsN);
         default: throw std::runtime_error("Unknown model index");
         }
     }
 
-    std::unique_ptr<CS_TrainBase> CreateTrain(size_t modelIdx, size_t insN, size_t outsN)
+    std::unique_ptr<CS_TrainBase> CreateTrain(size_t modelIdx, size_t insN, size_t outsN, size_t instanceIdx)
     {
         switch (modelIdx)
         {
-        case 0: return std::make_unique<CS_M1_Train>(insN, outsN);
-        case 1: return std::make_unique<CS_M2_Train>(insN, outsN);
+        case 0: return std::make_unique<CS_M1_Train>(insN, outsN, instanceIdx);
+        case 1: return std::make_unique<CS_M2_Train>(insN, outsN, instanceIdx);
+        case 2: return std::make_unique<CS_M3_Train>(insN, outsN, instanceIdx);
         default: throw std::runtime_error("Unknown model index");
         }
     }
@@ -16,7 +16,8 @@ namespace CS_ModelFactory
 
     std::unique_ptr<CS_BrainBase> CreateBrain(size_t modelIdx, const CS_Chromo& chromo, size_t insN, size_t outsN);
 
-    std::unique_ptr<CS_TrainBase> CreateTrain(size_t modelIdx, size_t insN, size_t outsN);
+    // instanceIdx distinguishes the trainers of the same run (i.e. islands)
+    std::unique_ptr<CS_TrainBase> CreateTrain(size_t modelIdx, size_t insN, size_t outsN, size_t instanceIdx = 0);
 
 } // namespace CS_ModelFactory
 
@@ -0,0 +1,57 @@
+#ifndef CS_MPSCQUEUE_H
+#define CS_MPSCQUEUE_H
+
+#include <atomic>
+#include <utility>
+
+// lock-free queue with many producers and a single consumer (D. Vyukov's node-based MPSC queue)
+// producers never wait on each other or on the consumer, a push is one exchange and one store
+template <typename T> class CS_MPSCQueue
+{
+    struct Node
+    {
+        std::atomic<Node*> next{};
+        T val{};
+    };
+
+    std::atomic<Node*> mHead; // last pushed, producers side
+    Node* mpTail;             // dummy node before the oldest, consumer side
+
+  public:
+    CS_MPSCQueue() : mHead(new Node()), mpTail(mHead.load()) {}
+
+    ~CS_MPSCQueue()
+    {
+        T val;
+        while (TryPop(val)) {}
+        delete mpTail;
+    }
+
+    CS_MPSCQueue(const CS_MPSCQueue&)            = delete;
+    CS_MPSCQueue& operator=(const CS_MPSCQueue&) = delete;
+
+    // any thread
+    void Push(T val)
+    {
+        auto* pNode = new Node();
+        pNode->val  = std::move(val);
+        // link after the previous head (the consumer won't see it until the store)
+        auto* pPrev = mHead.exchange(pNode, std::memory_order_acq_rel);
+        pPrev->next.store(pNode, std::memory_order_release);
+    }
+
+    // consumer thread only, false if empty (or if a push is still half way through)
+    bool TryPop(T& out_val)
+    {
+        auto* pNext = mpTail->next.load(std::memory_order_acquire);
+        if (!pNext) return false;
+
+        // the next node becomes the dummy
+        out_val = std::move(pNext->val);
+        delete mpTail;
+        mpTail = pNext;
+        return true;
+    }
+};
+
+#endif
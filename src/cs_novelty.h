@@ -0,0 +1,121 @@
+#ifndef CS_NOVELTY_H
+#define CS_NOVELTY_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <unordered_map>
+#include <vector>
+
+// what a brain did, as opposed to how well it did (e.g. where its units ended, normalized by the field size)
+struct CS_BehaviorDesc
+{
+    double x{};
+    double z{};
+
+    double DistTo(const CS_BehaviorDesc& o) const { return std::hypot(x - o.x, z - o.z); }
+};
+
+// archive of the behaviors seen so far, for novelty scores
+// indexed by a uniform grid, so that the k nearest can be found by looking at the few cells around
+// a cell keeps at most k entries, deliberately: crowded areas don't grow the archive (or the query time), and
+// since a full cell has k entries within a cell diagonal of anything dropped, no novelty moves by more than that
+// (with the default 1/64 cell over the unit field, that's at most 64 * 64 * k entries, ~61k for k = 15,
+// however many are added, see CS_Checks)
+class CS_NoveltyArchive
+{
+    const size_t mK;
+    const double mCellSize;
+
+    std::unordered_map<uint64_t, std::vector<CS_BehaviorDesc>> mCells;
+    size_t mEntriesN{};
+    // range of the occupied cells
+    int32_t mMinCX{std::numeric_limits<int32_t>::max()};
+    int32_t mMinCZ{std::numeric_limits<int32_t>::max()};
+    int32_t mMaxCX{std::numeric_limits<int32_t>::min()};
+    int32_t mMaxCZ{std::numeric_limits<int32_t>::min()};
+
+  public:
+    CS_NoveltyArchive(size_t k = 15, double cellSize = 1.0 / 64) : mK(k), mCellSize(cellSize) {}
+
+    size_t GetK() const { return mK; }
+
+    size_t GetEntriesN() const { return mEntriesN; }
+
+    void AddDesc(const CS_BehaviorDesc& desc)
+    {
+        const auto cx = toCell(desc.x);
+        const auto cz = toCell(desc.z);
+        auto& cell    = mCells[makeKey(cx, cz)];
+        if (cell.size() >= mK) return;
+
+        cell.push_back(desc);
+        ++mEntriesN;
+        mMinCX = std::min(mMinCX, cx);
+        mMinCZ = std::min(mMinCZ, cz);
+        mMaxCX = std::max(mMaxCX, cx);
+        mMaxCZ = std::max(mMaxCZ, cz);
+    }
+
+    // distances to the nearest (up to k), in increasing order
+    std::vector<double> FindNearestDists(const CS_BehaviorDesc& desc) const
+    {
+        std::vector<double> dists;
+        if (!mEntriesN) return dists;
+
+        const auto cx = toCell(desc.x);
+        const auto cz = toCell(desc.z);
+
+        // rings of cells of increasing distance, until nothing closer can be found
+        const auto maxR = std::max({cx - mMinCX, mMaxCX - cx, cz - mMinCZ, mMaxCZ - cz, 0});
+        for (int32_t r = 0; r <= maxR; ++r)
+        {
+            for (int32_t dz = -r; dz <= r; ++dz)
+            {
+                // only the border of the ring
+                const auto step = (dz == -r || dz == r) ? 1 : 2 * r;
+                for (int32_t dx = -r; dx <= r; dx += std::max(1, step))
+                {
+                    const auto it = mCells.find(makeKey(cx + dx, cz + dz));
+                    if (it == mCells.end()) continue;
+                    for (const auto& d : it->second) dists.push_back(desc.DistTo(d));
+                }
+            }
+
+            // the cells of the next ring are at least r cells away
+            if (dists.size() >= mK)
+            {
+                std::nth_element(dists.begin(), dists.begin() + (ptrdiff_t)(mK - 1), dists.end());
+                dists.resize(mK);
+                if (*std::max_element(dists.begin(), dists.end()) <= (double)r * mCellSize) break;
+            }
+        }
+        std::sort(dists.begin(), dists.end());
+        if (dists.size() > mK) dists.resize(mK);
+        return dists;
+    }
+
+    // mean distance to the k nearest, among the archive and the given population (skipping itself)
+    double CalcNovelty(const CS_BehaviorDesc& desc, const std::vector<CS_BehaviorDesc>& pop, size_t selfIdx) const
+    {
+        auto dists = FindNearestDists(desc);
+        for (size_t i = 0; i < pop.size(); ++i)
+            if (i != selfIdx) dists.push_back(desc.DistTo(pop[i]));
+
+        if (dists.empty()) return 0.0;
+
+        const auto n = std::min(mK, dists.size());
+        std::nth_element(dists.begin(), dists.begin() + (ptrdiff_t)(n - 1), dists.end());
+        double sum = 0;
+        for (size_t i = 0; i < n; ++i) sum += dists[i];
+        return sum / (double)n;
+    }
+
+  private:
+    int32_t toCell(double v) const { return (int32_t)std::floor(v / mCellSize); }
+
+    static uint64_t makeKey(int32_t cx, int32_t cz) { return ((uint64_t)(uint32_t)cx << 32) | (uint32_t)cz; }
+};
+
+#endif
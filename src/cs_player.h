@@ -1,46 +1,151 @@
 #ifndef CS_PLAYER
 #define CS_PLAYER
 
+#include <algorithm>
 #include <atomic>
+#include <cmath>
 #include <functional>
 #include <future>
 #include <memory>
+#include <string>
 #include <vector>
+#include <glm/gtc/constants.hpp>
 #include "cs_brainbase.h"
 #include "cs_sim.h"
+#include "cs_threadpool.h"
+#include "cs_trajrec.h"
 
 class CS_Player
 {
+  public:
+    static constexpr double STEP_S           = 1.0 / 60;
+    static constexpr size_t KEYFRAME_STEPS_N = 300; // a snapshot every 5 s, for seeking
+
+  private:
     std::unique_ptr<CS_BrainBase> moBrain;
     std::unique_ptr<CS_Sim> moSim;
     std::string mChromoHex;
 
   public:
-    using CreateSimFnT = std::function<std::unique_ptr<CS_Sim>(const CS_BrainBase&)>;
+    using CreateSimFnT = std::function<std::unique_ptr<CS_Sim>(const CS_BrainBase&, bool createDisp)>;
 
     struct Params
     {
         double chromoCost{};
         std::string chromoHex;
         CreateSimFnT createSimFn;
+        // run the sim once in the background, recording the poses of the units, then only play those back
+        bool useReplay{};
+        // if set, the background run also streams the trajectories of the units to this file (see CS_TrajReader)
+        std::string trajFName;
     };
 
   private:
     Params mPar;
 
+    // the same run is done once in the background, ahead of what's shown
+    // replay: poses of each unit at each step ([step][unit]), otherwise: keyframes to seek from
+    // both allocated for the whole run up front, so that what's recorded can be read while more is added
+    std::vector<CS_TrajSample> mRecPoses;
+    std::vector<std::vector<uint8_t>> mKeyframes;
+    std::atomic<size_t> mKeyframesN{};
+    std::atomic<size_t> mRecStepsN{};
+    std::atomic<bool> mStopRec{};
+    std::future<void> mRecFuture;
+    double mReplayTimeS{};
+
   public:
     CS_Player(const Params& par, std::unique_ptr<CS_BrainBase>&& oBrain) : moBrain(std::move(oBrain)), mPar(par)
     {
-        moSim = par.createSimFn(*moBrain);
+        moSim = par.createSimFn(*moBrain, true);
+
+        startRecording();
+    }
+
+    ~CS_Player()
+    {
+        mStopRec = true;
+        if (mRecFuture.valid()) mRecFuture.wait();
     }
 
     void AnimPlayer(double speedFactor, bool doDraw)
     {
+        if (mPar.useReplay)
+        {
+            if (!moSim->IsSimComplete()) SeekReplay(mReplayTimeS + speedFactor * STEP_S);
+            return;
+        }
+
         if (moSim->IsSimComplete()) return;
 
         const auto loopN = (size_t)speedFactor;
 
-        for (size_t i = 0; i < loopN && !moSim->IsSimComplete(); ++i) moSim->AnimSim(1.0 / 60, doDraw && i == 0);
+        for (size_t i = 0; i < loopN && !moSim->IsSimComplete(); ++i) moSim->AnimSim(STEP_S, doDraw && i == 0);
+    }
+
+    bool IsReplay() const { return mPar.useReplay; }
+
+    // how far the background run got
+    double GetRecordedTimeS() const { return (double)mRecStepsN.load(std::memory_order_acquire) * STEP_S; }
+
+    bool IsRecordingDone() const { return !mRecFuture.valid() || isFutureReady(mRecFuture); }
+
+    // moves the shown sim to the given time (clamped to where the background run got)
+    // live: restores the keyframe at or before the time, then simulates up to it (at most KEYFRAME_STEPS_N steps)
+    void Seek(double timeS)
+    {
+        if (mPar.useReplay)
+        {
+            SeekReplay(timeS);
+            return;
+        }
+
+        const auto kfN = mKeyframesN.load(std::memory_order_acquire);
+        if (!kfN) return;
+
+        const auto dstStep = std::min((size_t)std::lround(std::max(timeS, 0.0) / STEP_S),
+                                      mRecStepsN.load(std::memory_order_acquire));
+        const auto kfIdx   = std::min(dstStep / KEYFRAME_STEPS_N, kfN - 1);
+
+        // a short way forward is done from where the shown sim is
+        auto curStep       = (size_t)std::lround(moSim->GetCurSimTimeS() / STEP_S);
+        if (curStep > dstStep || curStep < kfIdx * KEYFRAME_STEPS_N)
+        {
+            if (!moSim->Restore(mKeyframes[kfIdx])) return;
+            curStep = kfIdx * KEYFRAME_STEPS_N;
+        }
+        for (; curStep < dstStep; ++curStep) moSim->AnimSim(STEP_S, false);
+    }
+
+    // shows the recorded run at the given time (clamped to what's recorded so far)
+    void SeekReplay(double timeS)
+    {
+        const auto recN = mRecStepsN.load(std::memory_order_acquire);
+        if (!recN) return;
+
+        mReplayTimeS      = std::clamp(timeS, 0.0, (double)recN * STEP_S);
+
+        // step i is the state at (i + 1) * STEP_S
+        const auto fstep  = std::clamp(mReplayTimeS / STEP_S - 1, 0.0, (double)(recN - 1));
+        const auto i0     = (size_t)fstep;
+        const auto i1     = std::min(i0 + 1, recN - 1);
+        const auto t      = (float)(fstep - (double)i0);
+
+        const auto unitsN = moSim->GetUnitsN();
+        for (size_t u = 0; u < unitsN; ++u)
+        {
+            const auto& p0 = mRecPoses[i0 * unitsN + u];
+            const auto& p1 = mRecPoses[i1 * unitsN + u];
+            // the rest of the state from the earlier step, only the motion is smoothed
+            auto pose      = p0;
+            pose.mPosX     = p0.mPosX + (p1.mPosX - p0.mPosX) * t;
+            pose.mPosZ     = p0.mPosZ + (p1.mPosZ - p0.mPosZ) * t;
+            pose.mYaw      = p0.mYaw + calcAngleDiff(p0.mYaw, p1.mYaw) * t;
+            moSim->SetUnitPose(u, pose);
+        }
+        moSim->SetCurSimTimeS(mReplayTimeS);
+
+        moSim->SetCompleted(IsRecordingDone() && mReplayTimeS >= (double)recN * STEP_S);
     }
 
     void AddMeshesToScenePlayer(ge::Scene& scene) const { moSim->AddMeshesToSceneSim(scene); }
@@ -51,7 +156,48 @@ class CS_Player
 
     const std::string& GetChromoHex() const { return mPar.chromoHex; }
 
+    // empty if not recording, or if the file couldn't be created
+    const std::string& GetTrajFName() const { return mPar.trajFName; }
+
     double GetChromoCost() const { return mPar.chromoCost; }
+
+  private:
+    void startRecording()
+    {
+        // same brain, its own sim (the brain is only read)
+        auto oRecSim         = mPar.createSimFn(*moBrain, false);
+        if (!mPar.trajFName.empty() && !oRecSim->StartRecording(mPar.trajFName)) mPar.trajFName.clear();
+        const auto unitsN    = oRecSim->GetUnitsN();
+        const auto maxStepsN = (size_t)std::ceil(oRecSim->mPars.mMaxTimeS / STEP_S) + 2;
+        if (mPar.useReplay)
+            mRecPoses.resize(maxStepsN * unitsN);
+        else
+            mKeyframes.resize(maxStepsN / KEYFRAME_STEPS_N + 1);
+
+        mRecFuture = std::async(std::launch::async, [this, oRecSim = std::move(oRecSim), unitsN, maxStepsN]() {
+            for (size_t step = 0; step < maxStepsN && !oRecSim->IsSimComplete() && !mStopRec; ++step)
+            {
+                // keyframe k is the state at k * KEYFRAME_STEPS_N steps
+                if (!mPar.useReplay && !(step % KEYFRAME_STEPS_N))
+                {
+                    const auto kfIdx  = step / KEYFRAME_STEPS_N;
+                    mKeyframes[kfIdx] = oRecSim->Snapshot();
+                    mKeyframesN.store(kfIdx + 1, std::memory_order_release);
+                }
+                oRecSim->AnimSim(STEP_S, false);
+                if (mPar.useReplay)
+                    for (size_t u = 0; u < unitsN; ++u) mRecPoses[step * unitsN + u] = oRecSim->GetUnitPose(u);
+                mRecStepsN.store(step + 1, std::memory_order_release);
+            }
+            oRecSim->StopRecording();
+        });
+    }
+
+    static float calcAngleDiff(float a, float b)
+    {
+        const auto d = b - a;
+        return d - glm::two_pi<float>() * std::round(d / glm::two_pi<float>());
+    }
 };
 
 #endif
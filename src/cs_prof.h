@@ -0,0 +1,152 @@
+#ifndef CS_PROF_H
+#define CS_PROF_H
+
+#include <array>
+#include <cstdint>
+
+// timers of the phases of the simulation step, compiled out entirely when not defined
+//#define CS_USE_PROF
+
+enum CS_ProfPhase : int {
+    CS_PROF_UNIT_GRID,  // units grid and collisions
+    CS_PROF_SENSE,      // brain inputs, ray scans
+    CS_PROF_BRAIN,      // brain forward pass
+    CS_PROF_PHYSICS,    // AnimateUnit()
+    CS_PROF_END_CHECK,  // cost and termination checks
+    CS_PROF_DEBUG_DRAW, // debug drawing
+    CS_PROF_N
+};
+
+inline const char* CS_ProfPhaseName(int phase)
+{
+    static const char* sNames[CS_PROF_N] = {"Unit grid", "Sense", "Brain", "Physics", "End check", "Debug draw"};
+    return sNames[phase];
+}
+
+// histogram of the durations of each scope, in powers of 2 of microseconds: bucket 0 is under 2 us,
+// bucket i from 2^i us, the last one everything longer
+static constexpr int CS_PROF_HIST_N = 16;
+
+inline int CS_ProfHistBucket(uint64_t ns)
+{
+    int b = 0;
+    for (auto us = ns / 1000; us >= 2 && b < CS_PROF_HIST_N - 1; us >>= 1) ++b;
+    return b;
+}
+
+// sums of all the threads, since the start
+struct CS_ProfTotals
+{
+    std::array<uint64_t, CS_PROF_N> ns{};
+    std::array<uint64_t, CS_PROF_N> counts{};
+    std::array<std::array<uint64_t, CS_PROF_HIST_N>, CS_PROF_N> hist{};
+};
+
+#ifdef CS_USE_PROF
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+// each thread adds to its own slots (no contention), the totals are gathered on demand
+// slots of threads that exit are folded into the retired totals, so short-lived workers don't pile up
+class CS_Prof
+{
+    struct ThreadSlots
+    {
+        std::array<std::atomic<uint64_t>, CS_PROF_N> ns{};
+        std::array<std::atomic<uint64_t>, CS_PROF_N> counts{};
+        std::array<std::array<std::atomic<uint64_t>, CS_PROF_HIST_N>, CS_PROF_N> hist{};
+
+        ThreadSlots()
+        {
+            auto& g = getGlobal();
+            std::lock_guard<std::mutex> lock(g.mutex);
+            g.live.push_back(this);
+        }
+
+        ~ThreadSlots()
+        {
+            auto& g = getGlobal();
+            std::lock_guard<std::mutex> lock(g.mutex);
+            for (int i = 0; i < CS_PROF_N; ++i)
+            {
+                g.retired.ns[i] += ns[i].load(std::memory_order_relaxed);
+                g.retired.counts[i] += counts[i].load(std::memory_order_relaxed);
+                for (int b = 0; b < CS_PROF_HIST_N; ++b)
+                    g.retired.hist[i][b] += hist[i][b].load(std::memory_order_relaxed);
+            }
+            g.live.erase(std::find(g.live.begin(), g.live.end(), this));
+        }
+    };
+
+    struct Global
+    {
+        std::mutex mutex;
+        std::vector<ThreadSlots*> live;
+        CS_ProfTotals retired;
+    };
+
+    static Global& getGlobal()
+    {
+        static Global sGlobal;
+        return sGlobal;
+    }
+
+  public:
+    static void Add(int phase, uint64_t ns)
+    {
+        thread_local ThreadSlots tSlots;
+        // only this thread writes, a plain load/store is enough
+        tSlots.ns[phase].store(tSlots.ns[phase].load(std::memory_order_relaxed) + ns, std::memory_order_relaxed);
+        tSlots.counts[phase].store(tSlots.counts[phase].load(std::memory_order_relaxed) + 1,
+                                   std::memory_order_relaxed);
+        auto& bucket = tSlots.hist[phase][CS_ProfHistBucket(ns)];
+        bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    static CS_ProfTotals GetTotals()
+    {
+        auto& g = getGlobal();
+        std::lock_guard<std::mutex> lock(g.mutex);
+        auto tot = g.retired;
+        for (const auto* pSlots : g.live)
+            for (int i = 0; i < CS_PROF_N; ++i)
+            {
+                tot.ns[i] += pSlots->ns[i].load(std::memory_order_relaxed);
+                tot.counts[i] += pSlots->counts[i].load(std::memory_order_relaxed);
+                for (int b = 0; b < CS_PROF_HIST_N; ++b)
+                    tot.hist[i][b] += pSlots->hist[i][b].load(std::memory_order_relaxed);
+            }
+        return tot;
+    }
+};
+
+class CS_ProfScope
+{
+    const int mPhase;
+    const std::chrono::steady_clock::time_point mStart;
+
+  public:
+    CS_ProfScope(int phase) : mPhase(phase), mStart(std::chrono::steady_clock::now()) {}
+
+    ~CS_ProfScope()
+    {
+        const auto dt = std::chrono::steady_clock::now() - mStart;
+        CS_Prof::Add(mPhase, (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(dt).count());
+    }
+};
+
+#define CS_PROF_CAT2(a, b) a##b
+#define CS_PROF_CAT(a, b) CS_PROF_CAT2(a, b)
+#define CS_PROF_SCOPE(phase) CS_ProfScope CS_PROF_CAT(_csProfScope, __LINE__)(phase)
+
+#else
+
+#define CS_PROF_SCOPE(phase)
+
+#endif
+
+#endif
@@ -7,6 +7,7 @@
 /*     2023/02/09       */
 /************************/
 
+#include <cmath>
 #include <glm/ext/matrix_transform.hpp>
 #include <glm/mat3x3.hpp>
 #include <glm/vec3.hpp>
@@ -18,6 +19,20 @@ inline auto IntegrateNewton = [](auto& pos, auto& vel, const auto& acc, auto dt)
     pos += (oldVel + vel) * static_cast<decltype(dt)>(0.5) * dt;
 };
 
+// exact for a constant acceleration with a linear drag (dv/dt = acc - drag * vel), at any step
+inline auto IntegrateExpDrag = [](auto& pos, auto& vel, const auto& acc, auto drag, auto dt) {
+    using T = decltype(dt);
+    if (drag < static_cast<T>(1e-6))
+    {
+        IntegrateNewton(pos, vel, acc, dt);
+        return;
+    }
+    const auto e       = std::exp(-drag * dt);
+    const auto termVel = acc / drag; // terminal velocity
+    pos += termVel * dt + (vel - termVel) * ((1 - e) / drag);
+    vel = termVel + (vel - termVel) * e;
+};
+
 #if 0
 template <typename T>
 inline bool IsGoodReal( const T &v )
@@ -61,11 +76,18 @@ template <typename T> class CS_RBodyT
         IntegrateNewton(mPosWS, mVelWS, mAccWS, dt);
 
         // mAngVelLS += torqueLS * dt;
-        auto tmp     = Mat4(mCurRotWS_LS);
-        tmp          = glm::rotate(tmp, mAngVelLS[0], Vec3{1, 0, 0});
-        tmp          = glm::rotate(tmp, mAngVelLS[1], Vec3{0, 1, 0});
-        tmp          = glm::rotate(tmp, mAngVelLS[2], Vec3{0, 0, 1});
-        mCurRotWS_LS = Mat3(tmp);
+        rotateByAngVel(1);
+    }
+
+    // forces and a linear drag (1/s) held over the step, integrated exactly (stable at larger steps than
+    // StepSimulation() followed by AttenuateVel())
+    // the rotation is split around the integration, the forces take the heading at rotFrac of it
+    void StepSimulationExpDrag(T dt, const Vec3& forcesLS, T drag, T rotFrac)
+    {
+        rotateByAngVel(rotFrac);
+        mAccWS = (mCurRotWS_LS * forcesLS) / mMass;
+        IntegrateExpDrag(mPosWS, mVelWS, mAccWS, drag, dt);
+        rotateByAngVel(1 - rotFrac);
     }
 
     // just a quick way to simulate any kind of drag or friction
@@ -74,6 +96,17 @@ template <typename T> class CS_RBodyT
     template <typename S> void AttenuateAngVel(S dt, S att) { mAngVelLS *= (T)(1 - att * dt); }
 
     template <typename S> void AttenuateAcc(S dt, S att) { mAccWS *= (T)(1 - att * dt); }
+
+  private:
+    // mAngVelLS is the rotation of a whole step
+    void rotateByAngVel(T frac)
+    {
+        auto tmp     = Mat4(mCurRotWS_LS);
+        tmp          = glm::rotate(tmp, mAngVelLS[0] * frac, Vec3{1, 0, 0});
+        tmp          = glm::rotate(tmp, mAngVelLS[1] * frac, Vec3{0, 1, 0});
+        tmp          = glm::rotate(tmp, mAngVelLS[2] * frac, Vec3{0, 0, 1});
+        mCurRotWS_LS = Mat3(tmp);
+    }
 };
 
 // using CS_RBody = CS_RBodyT<CS_SCALAR>;
@@ -12,16 +12,20 @@
 #include <random>
 #include "hdf5/hdf5_ext.h"
 #include "log/log.h"
+#include "cs_hash.h"
 #include "cs_math.h"
 #include "cs_modelfactory.h"
 #include "cs_player.h"
+#include "cs_prof.h"
 #include "cs_scenario.h"
 #include "cs_serialize.h"
 #include "cs_terrain.h"
+#include "cs_trace.h"
 #include "cs_trainer.h"
 #include "cs_unit.h"
 #include "cs_utils.h"
 #include "ge_mesh2.h"
+#include "implot.h"
 #include "mesh.h"
 #include "plasma2.h"
 #include "scene.h"
@@ -29,8 +33,16 @@
 #include "utils.h"
 
 #define TRAIN_SINGLE_TERRAIN
+//#define TRAIN_MULTI_FIDELITY
+//#define TRAIN_STEADY_STATE
+//#define TRAIN_ISLANDS
+//#define TRAIN_NOVELTY
+//#define TRAIN_MULTI_EPISODE
+//#define TRAIN_CURRICULUM
 
 static const std::string CS_CONFIG_FNAME = ".cs_config.json";
+static const std::string CS_TRACE_FNAME  = "cs_trace.json";
+static const std::string CS_TRAJ_FNAME   = "cs_trajs.bin";
 
 static auto localLog                     = [](const char* ftm, ...) {
     char buffer[2048]{};
@@ -41,33 +53,34 @@ static auto localLog                     = [](const char* ftm, ...) {
     LOGGER(logging::INFO) << buffer;
 };
 
-static CS_Sim::Params makeDefaultSimParams(const CS_Terrain& terr)
+// a position with some room around it, for a start or a target
+static bool isGoodSimPos(const CS_Terrain& terr, const glm::vec3& pos)
 {
-    const auto fieldSize = terr.GetFieldSize();
-    CS_Sim::Params par;
-    par.mInitUnitsN  = 1;
-    par.mMaxTimeS    = 60 * 15;
+    for (int ix = 0; ix <= 30; ix += 3)
+        for (int iz = 0; iz <= 30; iz += 3)
+        {
+            const auto sx     = ((ix & 1) * 2 - 1) * (ix / 2);
+            const auto sz     = ((iz & 1) * 2 - 1) * (iz / 2);
+            const auto fx     = (float)sx * terr.GetCellSize();
+            const auto fz     = (float)sz * terr.GetCellSize();
+            const auto posOff = pos + glm::vec3(fx, 0.f, fz);
 
-    // check with some
-    auto isGoodPoint = [&](const glm::vec3& pos) {
-        for (int ix = 0; ix <= 30; ix += 3)
-            for (int iz = 0; iz <= 30; iz += 3)
-            {
-                const auto sx     = ((ix & 1) * 2 - 1) * (ix / 2);
-                const auto sz     = ((iz & 1) * 2 - 1) * (iz / 2);
-                const auto fx     = (float)sx * terr.GetCellSize();
-                const auto fz     = (float)sz * terr.GetCellSize();
-                const auto posOff = pos + glm::vec3(fx, 0.f, fz);
+            if (!terr.IsPosInside(posOff)) return false;
 
-                if (!terr.IsPosInside(posOff)) return false;
+            if (terr.GetHeightFromPos(posOff) >= CS_Sim::GetWallHeight_s()) return false;
+        }
+    return true;
+}
 
-                if (terr.GetHeightFromPos(posOff) >= CS_Sim::GetWallHeight_s()) return false;
-            }
-        return true;
-    };
+static CS_Sim::Params makeDefaultSimParams(const CS_Terrain& terr)
+{
+    const auto fieldSize = terr.GetFieldSize();
+    CS_Sim::Params par;
+    par.mInitUnitsN   = 1;
+    par.mMaxTimeS     = 60 * 15;
 
     auto pickValidPos = [&](const glm::vec3& center) {
-        if (isGoodPoint(center)) return center;
+        if (isGoodSimPos(terr, center)) return center;
 
         for (int d = 1; d < 20; ++d)
         {
@@ -76,7 +89,7 @@ static CS_Sim::Params makeDefaultSimParams(const CS_Terrain& terr)
             {
                 const auto af  = (float)(2 * glm::pi<float>() * (float)a) / 200.f;
                 const auto pos = center + glm::vec3(cosf(af), 0, sinf(af)) * df;
-                if (isGoodPoint(pos)) return pos;
+                if (isGoodSimPos(terr, pos)) return pos;
             }
         }
         assert(0);
@@ -90,11 +103,116 @@ static CS_Sim::Params makeDefaultSimParams(const CS_Terrain& terr)
     return par;
 }
 
+#ifdef TRAIN_MULTI_EPISODE
+// the good positions on a coarse grid, to pick the episodes from
+static std::vector<glm::vec3> makeValidSimPositions(const CS_Terrain& terr)
+{
+    constexpr int GRID_N = 64;
+
+    std::vector<glm::vec3> poss;
+    const auto fieldSize = terr.GetFieldSize();
+    for (int iz = 0; iz < GRID_N; ++iz)
+        for (int ix = 0; ix < GRID_N; ++ix)
+        {
+            const auto pos = glm::vec3((float)ix + 0.5f, 0, (float)iz + 0.5f) * (fieldSize / GRID_N) -
+                             glm::vec3(fieldSize / 2, 0, fieldSize / 2);
+            if (isGoodSimPos(terr, pos)) poss.push_back(pos);
+        }
+    return poss;
+}
+
+// the default episode, plus more random ones, with targets far enough and reachable from the start
+static void addRandomEpisodes(CS_Sim::Params& par, const CS_Terrain& terr, size_t episodesN, uint32_t seed)
+{
+    const auto poss = makeValidSimPositions(terr);
+    if (poss.size() < 2) return;
+
+    const auto minDist = terr.GetFieldSize() * 0.3f;
+
+    par.mEpisodes.clear();
+    par.mEpisodes.push_back({par.mStartPos, par.mTargetPos});
+
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<size_t> posDist(0, poss.size() - 1);
+    for (size_t tryI = 0; tryI < episodesN * 100 && par.mEpisodes.size() < episodesN; ++tryI)
+    {
+        const auto& sta = poss[posDist(rng)];
+        const auto& tar = poss[posDist(rng)];
+        if (glm::distance(sta, tar) < minDist) continue;
+
+        // the field is cached by the terrain, the sims will use it again
+        const auto staCell = terr.getCellFromPos(sta);
+        if (terr.GetFlowField(tar, (float)CS_Sim::WALL_HEIGHT)->GetDist(staCell[0], staCell[1]) < 0) continue;
+
+        par.mEpisodes.push_back({sta, tar});
+    }
+}
+#endif
+
+// simulation steps per second in training
+#ifdef CS_USE_EXP_DRAG_INTEGRATOR
+static constexpr size_t TRAIN_STEPS_PER_S = 20;
+#else
+static constexpr size_t TRAIN_STEPS_PER_S = 60;
+#endif
+
+// run the brain on simsN scenarios starting at staIdx, for a fraction of their max time and return the average cost
+// returns early, with a lower bound of the cost, once that is above costBound
+// the behavior is where the units ended, normalized by the field size and averaged over the scenarios run
+static double evalBrainOnSims(const CS_BrainBase& brain, const std::vector<CS_Sim::Params>& simPars,
+                              const std::vector<std::unique_ptr<CS_Terrain>>& terrs, double timeFrac, size_t staIdx,
+                              size_t simsN, std::atomic<bool>& reqShutdown, const CS_CostBound& costBound,
+                              CS_BehaviorDesc* pOutDesc)
+{
+    if (pOutDesc) *pOutDesc = {};
+    auto addDesc = [&](const CS_Sim& sim, size_t doneN) {
+        if (!pOutDesc) return;
+        const auto pos = sim.CalcAvgUnitsPos() / (CS_RBody::Scalar)sim.mTerrain.GetFieldSize();
+        pOutDesc->x += ((double)pos[0] - pOutDesc->x) / (double)doneN;
+        pOutDesc->z += ((double)pos[2] - pOutDesc->z) / (double)doneN;
+    };
+
+    double totCost = 0;
+    for (size_t sidx = staIdx; sidx < staIdx + simsN; ++sidx)
+    {
+        auto simPar = simPars[sidx];
+        simPar.mMaxTimeS *= timeFrac;
+
+        // create a simulation for the given scenario and brain
+        auto oSim = std::make_unique<CS_Sim>(simPar, *terrs[sidx], brain, false);
+
+        // run to completion (includes timeout)
+        for (size_t stepI = 1; !oSim->IsSimComplete() && !reqShutdown; ++stepI)
+        {
+            oSim->AnimSim(1.0 / (double)TRAIN_STEPS_PER_S, false);
+
+            // every simulated second, give up if it can't be among the best anymore
+            // (the sims still to run have a cost of at least 0)
+            if (!(stepI % TRAIN_STEPS_PER_S))
+            {
+                const auto minCost = (totCost + oSim->CalcAvgCostLowerBound()) / (double)simsN;
+                if (minCost > costBound.Get())
+                {
+                    addDesc(*oSim, sidx - staIdx + 1);
+                    return minCost;
+                }
+            }
+        }
+
+        totCost += oSim->GetAvgTotalCost();
+        addDesc(*oSim, sidx - staIdx + 1);
+    }
+
+    return totCost / (double)simsN;
+}
+
 static void to_json(nlohmann::json& j, const CS_Scenario& v)
 {
     j = nlohmann::json{
         CS_SERIALIZE_VAL(mInitUnitsN),
         CS_SERIALIZE_VAL(mCurModelIdx),
+        CS_SERIALIZE_VAL(mUseSurrogate),
+        CS_SERIALIZE_VAL(mTraceEnabled),
         {"mTrain::Setup", v.msTrain->MakeSetup()},
     };
 }
@@ -103,6 +221,8 @@ static void from_json(const nlohmann::json& j, CS_Scenario& v)
 {
     CS_DESERIALIZE_VAL(mInitUnitsN);
     CS_DESERIALIZE_VAL(mCurModelIdx);
+    CS_DESERIALIZE_VAL(mUseSurrogate);
+    CS_DESERIALIZE_VAL(mTraceEnabled);
     if (auto it = j.find("mTrain::Setup"); it != j.end())
         v.msTrain = std::make_unique<CS_ScenarioTrain>(it->get<CS_ScenarioTrain::Setup>());
 }
@@ -129,6 +249,8 @@ CS_Scenario::CS_Scenario()
 #endif
 
     readConfig();
+
+    applyTraceEnabled();
 }
 
 CS_Scenario::~CS_Scenario()
@@ -176,6 +298,20 @@ void CS_Scenario::writeConfig() const
     }
 }
 
+void CS_Scenario::applyTraceEnabled()
+{
+    if (!mTraceEnabled)
+    {
+        CS_Trace::Stop();
+        return;
+    }
+    if (!CS_Trace::Start(CS_TRACE_FNAME))
+    {
+        localLog("Failed to open the trace file: %s", CS_TRACE_FNAME.c_str());
+        mTraceEnabled = false;
+    }
+}
+
 void CS_Scenario::reqWriteConfig()
 {
     // request to write the config in 1 second
@@ -213,8 +349,11 @@ void CS_Scenario::AddMeshesToScene(ge::Scene& scene)
         sim.AddMeshesToSceneSim(scene);
         const auto staCol = glm::vec4(0.0f, 0.8f, 0.0f, 1);
         const auto tarCol = glm::vec4(0.8f, 0.0f, 0.0f, 1);
-        mTest.moTerr->DI_DrawCellAtPos(sim.mPars.mStartPos, staCol, staCol);
-        mTest.moTerr->DI_DrawCellAtPos(sim.mPars.mTargetPos, tarCol, tarCol);
+        for (const auto& ep : sim.GetEpisodes())
+        {
+            mTest.moTerr->DI_DrawCellAtPos(ep.mStartPos, staCol, staCol);
+            mTest.moTerr->DI_DrawCellAtPos(ep.mTargetPos, tarCol, tarCol);
+        }
     }
 
     mTest.moTerr->DI_Flush();
@@ -225,6 +364,48 @@ void CS_Scenario::OnPickedMeshSce(const ge::Mesh* pMesh)
     if (mTest.moPlayer) mTest.moPlayer->GetPlayerSim().OnPickedMeshSim(pMesh);
 }
 
+#ifdef CS_USE_PROF
+// time of each phase of the sim steps, for each epoch, stacked
+static void drawProfPlot(const std::vector<std::array<double, CS_PROF_N>>& epochsMS)
+{
+    if (epochsMS.empty()) return;
+
+    if (!ImPlot::BeginPlot("##SimStepPhases", ImVec2(-1, UIB_ContentSca * 150))) return;
+
+    ImPlot::SetupAxes("Epoch", "Thread ms", ImPlotAxisFlags_AutoFit, ImPlotAxisFlags_AutoFit);
+
+    const auto n = epochsMS.size();
+    std::vector<double> xs(n);
+    std::vector<double> lows(n, 0.0);
+    std::vector<double> highs(n);
+    for (size_t e = 0; e < n; ++e) xs[e] = (double)e;
+
+    for (int i = 0; i < CS_PROF_N; ++i)
+    {
+        for (size_t e = 0; e < n; ++e) highs[e] = lows[e] + epochsMS[e][i];
+        ImPlot::PlotShaded(CS_ProfPhaseName(i), xs.data(), lows.data(), highs.data(), (int)n);
+        lows = highs;
+    }
+    ImPlot::EndPlot();
+}
+
+// how long each phase takes, per chunk of units of a step, over the last epoch
+static void drawProfHist(const std::array<std::array<double, CS_PROF_HIST_N>, CS_PROF_N>& hist)
+{
+    if (!ImPlot::BeginPlot("##SimStepPhasesHist", ImVec2(-1, UIB_ContentSca * 150))) return;
+
+    ImPlot::SetupAxes("log2 us", "Count", ImPlotAxisFlags_AutoFit, ImPlotAxisFlags_AutoFit);
+
+    std::array<double, CS_PROF_HIST_N> xs;
+    for (int b = 0; b < CS_PROF_HIST_N; ++b) xs[b] = (double)b;
+
+    for (int i = 0; i < CS_PROF_N; ++i)
+        ImPlot::PlotLine(CS_ProfPhaseName(i), xs.data(), hist[i].data(), CS_PROF_HIST_N);
+
+    ImPlot::EndPlot();
+}
+#endif
+
 void CS_Scenario::draw_TrainUI()
 {
     // draw terrain setup and see if we need to change it
@@ -238,12 +419,24 @@ void CS_Scenario::draw_TrainUI()
     {
         if (ImGui::Button("Stop Training")) { msTrain->moTrainer->ReqShutdown(); }
         ImGui::SameLine();
-        ImGui::Text("Training epoch:%zu...", msTrain->moTrainer->GetCurEpochN());
+        if (msTrain->moTrainer->IsSteadyState())
+            ImGui::Text("Evaluations completed:%zu...", msTrain->moTrainer->GetEvalsDoneN());
+        else
+            ImGui::Text("Training epoch:%zu...", msTrain->moTrainer->GetCurEpochN());
     }
     else
     {
         if (ImGui::Button("Start Training"))
         {
+#ifdef CS_USE_EXP_DRAG_INTEGRATOR
+            {
+                const auto err = CS_Unit::CalcIntegratorErr(1.0 / (double)TRAIN_STEPS_PER_S);
+                localLog("Integrator at 1/%zu s: max pos err %.3f m (tol %.2f, over %.0f m), max yaw err %.4f rad "
+                         "(tol %.3f)",
+                         TRAIN_STEPS_PER_S, err.mMaxPosErrM, CS_Unit::INTEGRATOR_MAX_POS_ERR_M, err.mDistM,
+                         err.mMaxYawErrRad, CS_Unit::INTEGRATOR_MAX_YAW_ERR_RAD);
+            }
+#endif
             const auto variants = msTrain->mTerrSetup.MakeVariants();
             // create one terrain for each simulation scenario
             for (size_t i = 0; i < variants.size(); ++i)
@@ -253,35 +446,92 @@ void CS_Scenario::draw_TrainUI()
 
                 auto simPar        = makeDefaultSimParams(*msTrain->moTerrs.back());
                 simPar.mInitUnitsN = 1;
+#ifdef TRAIN_MULTI_EPISODE
+                // many start/target pairs, so that the brains don't learn just one route
+                // (all in the same sim, the cost is the mean of the episodes, see CS_Sim::CostReduce)
+                addRandomEpisodes(simPar, *msTrain->moTerrs.back(), 8, (uint32_t)(1000 + i));
+                simPar.mCostReduce = CS_Sim::CostReduce::MEAN;
+#endif
                 msTrain->mSimPars.push_back(simPar);
             }
 
             CS_Trainer::Params par;
-            par.maxEpochsN  = 5000;
+            par.maxEpochsN   = 5000;
+            par.useSurrogate = mUseSurrogate;
 
-            par.evalBrainFn = [&simPars = msTrain->mSimPars,
-                               &terrs   = msTrain->moTerrs](const CS_BrainBase& brain, std::atomic<bool>& reqShutdown) {
-                double totCost = 0;
-                for (size_t sidx = 0; sidx < simPars.size(); ++sidx)
-                {
-                    // create a simulation for the given scenario and brain
-                    auto oSim = std::make_unique<CS_Sim>(simPars[sidx], *terrs[sidx], brain, false);
+            // identify the scenario, for the cached costs
+            {
+                nlohmann::json jfp;
+                jfp["terrs"]      = variants;
+                jfp["sims"]       = msTrain->mSimPars;
+                jfp["simCodeVer"] = CS_Sim::CODE_VERSION;
+                for (const auto& sp : msTrain->mSimPars) jfp["simUnitsN"].push_back(sp.mInitUnitsN);
+                par.scenarioFingerprint = CS_HashString64(jfp.dump());
+            }
 
-                    // run to completion (includes timeout)
-                    while (!oSim->IsSimComplete() && !reqShutdown) oSim->AnimSim(1.0 / 60.0, false);
+            par.evalBrainFn = [&simPars = msTrain->mSimPars, &terrs = msTrain->moTerrs](
+                                  const CS_BrainBase& brain, std::atomic<bool>& reqShutdown,
+                                  const CS_CostBound& costBound, CS_BehaviorDesc* pOutDesc) {
+                return evalBrainOnSims(brain, simPars, terrs, 1.0, 0, simPars.size(), reqShutdown, costBound,
+                                       pOutDesc);
+            };
 
-                    totCost += oSim->GetAvgTotalCost();
-                }
+            // each terrain of each brain is a separate task
+            par.terrainsN       = msTrain->mSimPars.size();
+            par.evalBrainTerrFn = [&simPars = msTrain->mSimPars, &terrs = msTrain->moTerrs](
+                                      const CS_BrainBase& brain, const CS_Trainer::EvalRung& rung, size_t terrIdx,
+                                      std::atomic<bool>& reqShutdown, const CS_CostBound& costBound,
+                                      CS_BehaviorDesc* pOutDesc) {
+                return evalBrainOnSims(brain, simPars, terrs, rung.timeFrac, terrIdx, 1, reqShutdown, costBound,
+                                       pOutDesc);
+            };
+
+#ifdef TRAIN_STEADY_STATE
+            // no waiting for the slowest of an epoch
+            par.useSteadyState = true;
+#endif
+
+#ifdef TRAIN_ISLANDS
+            // separate populations, sharing the terrains, with an occasional exchange of the best
+            par.islandsN          = 4;
+            par.migrationInterval = 10;
+            par.migrantsN         = 2;
+#endif
+
+#ifdef TRAIN_NOVELTY
+            // reward going where no one has been, for terrains where the straight line to the target is a trap
+            par.noveltyWeight = 0.5;
+#endif
+
+#ifdef TRAIN_CURRICULUM
+            // short horizons first, when most brains crash or stall anyway, longer ones once they plateau
+            par.horizonStartFrac      = 0.1;
+            par.horizonGrowFactor     = 2.0;
+            par.horizonPlateauEpochsN = 10;
+#endif
 
-                return totCost / static_cast<double>(simPars.size());
+#ifdef TRAIN_MULTI_FIDELITY
+            // short runs on one terrain first, only the best get to run on all, to the end
+            par.evalRungs = {
+                {0.1, 1, 0.3},
+                {0.4, 0, 0.4},
+                {1.0, 0, 1.0},
             };
+#endif
 
             // create the trainer
-            msTrain->moTrainer = std::make_unique<CS_Trainer>(
-                par, CS_ModelFactory::CreateTrain(mCurModelIdx, (size_t)CS_SENS_N, (size_t)CS_CTRL_N));
+            msTrain->moTrainer = std::make_unique<CS_Trainer>(par, [modelIdx = mCurModelIdx](size_t islIdx) {
+                return CS_ModelFactory::CreateTrain(modelIdx, (size_t)CS_SENS_N, (size_t)CS_CTRL_N, islIdx);
+            });
 
             msTrain->mLastEpoch      = 0;
             msTrain->mLastEpochTimeS = ut::GetSteadyTimeS();
+            msTrain->mStartTimeS     = msTrain->mLastEpochTimeS;
+#ifdef CS_USE_PROF
+            msTrain->mProfEpochsMS.clear();
+            msTrain->mProfLastEpochHist = {};
+            msTrain->mLastProfTotals    = CS_Prof::GetTotals();
+#endif
         }
         ImGui::SameLine();
         ImGui::SetNextItemWidth(UIB_ContentSca * 150);
@@ -300,20 +550,51 @@ void CS_Scenario::draw_TrainUI()
             }
             ImGui::EndCombo();
         }
+        if (ImGui::Checkbox("Surrogate screening", &mUseSurrogate)) reqWriteConfig();
     }
 
     if (msTrain->moTrainer)
     {
-        if (msTrain->mLastEpochLenTimeS)
+        if (msTrain->moTrainer->IsSteadyState())
+        {
+            const auto elapsedS = ut::GetSteadyTimeS() - msTrain->mStartTimeS;
+            const auto evalsN   = msTrain->moTrainer->GetEvalsDoneN();
+            if (evalsN && elapsedS > 0)
+                ImGui::Text("Evaluations per hour: %.1f", 60 * 60 * (double)evalsN / elapsedS);
+            else
+                ImGui::Text("Evaluations per hour: -");
+        }
+        else if (msTrain->mLastEpochLenTimeS)
         {
             ImGui::Text("Epoch time: %.1fs", msTrain->mLastEpochLenTimeS);
             ImGui::Text("Epochs per hour: %.1f", 60 * 60 / msTrain->mLastEpochLenTimeS);
+#ifdef CS_USE_PROF
+            drawProfPlot(msTrain->mProfEpochsMS);
+            drawProfHist(msTrain->mProfLastEpochHist);
+#endif
         }
         else
         {
             ImGui::Text("Epoch time: -");
             ImGui::Text("Epochs per hour: -");
         }
+        if (const auto horFrac = msTrain->moTrainer->GetCurHorizonFrac(); horFrac < 1.0)
+            ImGui::Text("Horizon: %.0f%%", horFrac * 100);
+        if (const auto hitsN = msTrain->moTrainer->GetCacheHitsN(); hitsN || msTrain->moTrainer->GetCacheMissesN())
+            ImGui::Text("Cached evals: %zu/%zu", hitsN, hitsN + msTrain->moTrainer->GetCacheMissesN());
+        if (const auto corr = msTrain->moTrainer->GetSurrogateRankCorr(); !std::isnan(corr))
+            ImGui::Text("Surrogate rank correlation: %.2f", corr);
+    }
+
+    if (ImGui::Checkbox(("Trace to " + CS_TRACE_FNAME).c_str(), &mTraceEnabled))
+    {
+        applyTraceEnabled();
+        reqWriteConfig();
+    }
+    if (const auto droppedN = CS_Trace::GetDroppedN())
+    {
+        ImGui::SameLine();
+        ImGui::Text("(dropped %llu)", (unsigned long long)droppedN);
     }
 
     if (UIB_Header("Brains", true, true))
@@ -357,10 +638,12 @@ void CS_Scenario::draw_TrainUI()
                     CS_Player::Params par;
                     par.chromoCost  = ci.ci_cost;
                     par.chromoHex   = mBestChromos[i].ToHashHex();
-                    par.createSimFn = [this](const CS_BrainBase& brain) {
+                    par.useReplay   = mTest.mUseReplay;
+                    par.trajFName   = mTest.mRecordTrajs ? CS_TRAJ_FNAME : std::string();
+                    par.createSimFn = [this](const CS_BrainBase& brain, bool createDisp) {
                         auto simPar        = makeDefaultSimParams(*mTest.moTerr);
                         simPar.mInitUnitsN = 1;
-                        return std::make_unique<CS_Sim>(simPar, *mTest.moTerr, brain, true);
+                        return std::make_unique<CS_Sim>(simPar, *mTest.moTerr, brain, createDisp);
                     };
 
                     mTest.moPlayer = std::make_unique<CS_Player>(
@@ -384,10 +667,22 @@ void CS_ScenarioTest::DrawTestUI()
 
     ImGui::SetNextItemWidth(ImGui::GetWindowWidth() * 0.5f);
     UIB_SlideDouble("Speed", &mSpeedFactor, 1.0, 20.0, "%.1f");
+    ImGui::Checkbox("Replay (record in the background)", &mUseReplay);
+    ImGui::Checkbox(("Record trajectories to " + CS_TRAJ_FNAME).c_str(), &mRecordTrajs);
 
     if (moPlayer)
     {
         ImGui::Text("Testing...");
+        ImGui::Text("%s: %.1fs%s", moPlayer->IsReplay() ? "Recorded" : "Pre-run", moPlayer->GetRecordedTimeS(),
+                    moPlayer->IsRecordingDone() ? "" : "...");
+
+        // timeline, up to where the background run got
+        auto timeS = moPlayer->GetPlayerSim().GetCurSimTimeS();
+        ImGui::SetNextItemWidth(ImGui::GetWindowWidth() * 0.5f);
+        if (UIB_SlideDouble("Time", &timeS, 0.0, moPlayer->GetRecordedTimeS(), "%.1fs")) moPlayer->Seek(timeS);
+
+        if (!moPlayer->GetTrajFName().empty()) ImGui::Text("Recording to %s", moPlayer->GetTrajFName().c_str());
+
         ImGui::Text("Chromo: %s", moPlayer->GetChromoHex().c_str());
         ImGui::Text("Cost: %s", CS_MakeCostString(moPlayer->GetChromoCost()).c_str());
 
@@ -35,6 +35,10 @@ class CS_ScenarioTest
     std::unique_ptr<CS_Terrain> moTerr;
     std::unique_ptr<CS_Player> moPlayer;
     double mSpeedFactor{20};
+    // new tests play back a run recorded in the background, rather than simulating it each frame
+    bool mUseReplay{true};
+    // the run of new tests is also streamed to a file (see CS_TrajReader)
+    bool mRecordTrajs{};
 
     bool mShowWindow{true};
 
@@ -51,6 +55,11 @@ class CS_Scenario
     std::unique_ptr<CS_BrainBase> moCurBrain;
 
     size_t mCurModelIdx = 0;
+    // pre-screen the offspring of the training with a surrogate model of the cost
+    bool mUseSurrogate = false;
+
+    // timeline of the trainer and the UI, as a Chrome trace
+    bool mTraceEnabled = false;
 
     std::shared_ptr<CS_ScenarioTrain> msTrain;
     CS_ScenarioTest mTest;
@@ -77,6 +86,7 @@ class CS_Scenario
     void writeConfig() const;
     void stopTesting();
     void draw_TrainUI();
+    void applyTraceEnabled();
 };
 
 #endif
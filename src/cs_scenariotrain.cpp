@@ -56,6 +56,18 @@ void CS_ScenarioTrain::AnimateSceTrain()
         mLastEpochLenTimeS  = curTimeS - mLastEpochTimeS;
         mLastEpoch          = curEpoch;
         mLastEpochTimeS     = curTimeS;
+
+#ifdef CS_USE_PROF
+        const auto totals = CS_Prof::GetTotals();
+        auto& epochMS     = mProfEpochsMS.emplace_back();
+        for (int i = 0; i < CS_PROF_N; ++i)
+        {
+            epochMS[i] = (double)(totals.ns[i] - mLastProfTotals.ns[i]) * 1e-6;
+            for (int b = 0; b < CS_PROF_HIST_N; ++b)
+                mProfLastEpochHist[i][b] = (double)(totals.hist[i][b] - mLastProfTotals.hist[i][b]);
+        }
+        mLastProfTotals = totals;
+#endif
     }
 
     auto& fut = moTrainer->GetTrainerFuture();
@@ -1,6 +1,9 @@
 #ifndef CS_SCENARIOTRAIN_H
 #define CS_SCENARIOTRAIN_H
 
+#include <array>
+#include <vector>
+#include "cs_prof.h"
 #include "cs_scenarioterrsetup.h"
 #include "cs_serialize_fwd.h"
 #include "cs_trainbase.h"
@@ -28,6 +31,15 @@ class CS_ScenarioTrain
     size_t mLastEpoch         = 0;
     double mLastEpochTimeS    = 0;
     double mLastEpochLenTimeS = 0;
+    double mStartTimeS        = 0;
+
+#ifdef CS_USE_PROF
+    // thread-milliseconds of each phase of the sim step, for each epoch
+    std::vector<std::array<double, CS_PROF_N>> mProfEpochsMS;
+    // durations of each phase in the last epoch, per chunk of units of a step (see CS_ProfHistBucket())
+    std::array<std::array<double, CS_PROF_HIST_N>, CS_PROF_N> mProfLastEpochHist{};
+    CS_ProfTotals mLastProfTotals;
+#endif
 
     bool mShowWindow{true};
 
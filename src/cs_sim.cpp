@@ -5,6 +5,8 @@
 /************************/
 
 #include <algorithm>
+#include <cstring>
+#include <type_traits>
 #ifndef _MSC_VER
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wdeprecated-declarations"
@@ -14,11 +16,16 @@
 #include <glm/gtx/string_cast.hpp>
 #endif
 #include <glm/glm.hpp>
+#include "cs_flowfield.h"
 #include "cs_math.h"
+#include "cs_prof.h"
 #include "cs_serialize.h"
 #include "cs_sim.h"
 #include "cs_terrain.h"
+#include "cs_threadpool.h"
+#include "cs_trajrec.h"
 #include "cs_unit.h"
+#include "cs_unitgrid.h"
 #include "cs_utils.h"
 #include "implot.h"
 #include "mesh.h"
@@ -63,13 +70,31 @@ namespace glm
 
 } // namespace glm
 
+void to_json(nlohmann::json& j, const CS_Sim::Episode& v)
+{
+    j = nlohmann::json{
+        CS_SERIALIZE_VAL(mStartPos),
+        CS_SERIALIZE_VAL(mTargetPos),
+    };
+}
+
+void from_json(const nlohmann::json& j, CS_Sim::Episode& v)
+{
+    CS_DESERIALIZE_VAL(mStartPos);
+    CS_DESERIALIZE_VAL(mTargetPos);
+}
+
 void to_json(nlohmann::json& j, const CS_Sim::Params& v)
 {
     j = nlohmann::json{
         // CS_SERIALIZE_VAL(mInitUnitsN),
         CS_SERIALIZE_VAL(mStartPos),
         CS_SERIALIZE_VAL(mTargetPos),
+        CS_SERIALIZE_VAL(mEpisodes),
+        CS_SERIALIZE_VAL(mCostReduce),
+        CS_SERIALIZE_VAL(mTrimFrac),
         CS_SERIALIZE_VAL(mMaxTimeS),
+        CS_SERIALIZE_VAL(mUnitCollisions),
     };
 }
 
@@ -78,11 +103,43 @@ void from_json(const nlohmann::json& j, CS_Sim::Params& v)
     // CS_DESERIALIZE_VAL(mInitUnitsN);
     CS_DESERIALIZE_VAL(mStartPos);
     CS_DESERIALIZE_VAL(mTargetPos);
+    CS_DESERIALIZE_VAL(mEpisodes);
+    CS_DESERIALIZE_VAL(mCostReduce);
+    CS_DESERIALIZE_VAL(mTrimFrac);
     CS_DESERIALIZE_VAL(mMaxTimeS);
+    CS_DESERIALIZE_VAL(mUnitCollisions);
 }
 
 CS_Sim::CS_Sim(const Params& par, CS_Terrain& terr, const CS_BrainBase& brain, bool createDisp)
     : mPars(par), mTerrain(terr), mBrain(brain)
+{
+    mEpisodes = mPars.mEpisodes;
+    if (mEpisodes.empty()) mEpisodes.push_back({mPars.mStartPos, mPars.mTargetPos});
+
+    // all the episodes run together, in the same sim
+    for (size_t epIdx = 0; epIdx < mEpisodes.size(); ++epIdx) ctor_addEpisodeUnits(epIdx, createDisp);
+
+    // start the selection with the first unit
+    mpCurSelUnit = moUnits[0].get();
+
+#if defined(CS_USE_GEODESIC_COST) || defined(CS_USE_FLOW_DIR_SENSORS)
+    // episodes with the same target share the field
+    for (const auto& ep : mEpisodes) mFlowFields.push_back(mTerrain.GetFlowField(ep.mTargetPos, (float)WALL_HEIGHT));
+#endif
+
+#ifndef CS_USE_UNIT_SENSOR
+    if (mPars.mUnitCollisions)
+#endif
+    {
+        // a whole number of terrain cells, large enough for a collision to only involve the cells around
+        const auto terrCellSize = mTerrain.GetCellSize();
+        const auto cellSize     = terrCellSize * std::ceil((float)(UNIT_RADIUS_M * 2) / terrCellSize);
+        const auto hsiz         = mTerrain.GetFieldSize() / 2;
+        moUnitGrid              = std::make_unique<CS_UnitGrid>(-hsiz, -hsiz, mTerrain.GetFieldSize(), cellSize);
+    }
+}
+
+void CS_Sim::ctor_addEpisodeUnits(size_t epIdx, bool createDisp)
 {
     const float distX = mTerrain.GetCellSize() * 8.0f;
     const float distZ = mTerrain.GetCellSize() * 8.0f;
@@ -94,6 +151,9 @@ CS_Sim::CS_Sim(const Params& par, CS_Terrain& terr, const CS_BrainBase& brain, b
     const auto colsN  = sideN;
     const auto rowsN  = sideN;
 
+    const auto& staPos = mEpisodes[epIdx].mStartPos;
+
+    size_t epUnitsN = 0;
     for (size_t row = 0; row < rowsN; ++row)
     {
         for (size_t col = 0; col < colsN; ++col)
@@ -106,8 +166,8 @@ CS_Sim::CS_Sim(const Params& par, CS_Terrain& terr, const CS_BrainBase& brain, b
             const auto sz   = ((iz & 1) * 2 - 1) * (iz / 2);
             const auto offX = (float)sx * distX;
             const auto offZ = (float)sz * distZ;
-            const float x   = (float)mPars.mStartPos[0] + offX;
-            const float z   = (float)mPars.mStartPos[2] + offZ;
+            const float x   = (float)staPos[0] + offX;
+            const float z   = (float)staPos[2] + offZ;
             const auto pos  = glm::vec3(x, 0, z);
 
             // skip bad positions
@@ -118,14 +178,11 @@ CS_Sim::CS_Sim(const Params& par, CS_Terrain& terr, const CS_BrainBase& brain, b
             const auto unitID = moUnits.size();
             // create the unit
             moUnits.push_back(std::make_unique<CS_Unit>("car", unitID, pos, createDisp));
+            moUnits.back()->mEpisodeIdx = epIdx;
 
-            if (moUnits.size() >= n) break;
+            if (++epUnitsN >= n) return;
         }
-        if (moUnits.size() >= n) break;
     }
-
-    // start the selection with the first unit
-    mpCurSelUnit = moUnits[0].get();
 }
 
 CS_Sim::~CS_Sim() = default;
@@ -158,7 +215,8 @@ static auto calcYaw                    = [](const auto& fwd) { return (decltype(
 
 // basic unit brain... stock logic, no machine learning
 static void prepareBrainInputs(CSM_Vec& inputs, const CS_Unit& u, const glm::dvec3& targetPos,
-                               const CS_Terrain& terrain,
+                               const CS_Terrain& terrain, const CS_FlowField* pFlowField,
+                               const CS_UnitGrid* pUnitGrid, size_t unitIdx,
                                const std::function<void(const glm::vec3&, const glm::vec4&)>& drawDebugDotFn)
 {
     const auto& rb             = u.GetRBody();
@@ -180,7 +238,29 @@ static void prepareBrainInputs(CSM_Vec& inputs, const CS_Unit& u, const glm::dve
     inputs[CS_SENS_PROBE_UNIT] = (CS_SCALAR)probeUnit;
 
     const auto WALL_HEIGHT     = 0.5f;
+    const auto maxDistance     = terrain.GetFieldSize();
 
+#ifdef CS_USE_LIDAR_SENSOR
+    // beam 0 straight ahead, as far as the center probe would reach
+    const auto fwdAng = std::atan2((float)fwdVec[2], (float)fwdVec[0]);
+
+    float hitDists[CS_LIDAR_BEAMS_N];
+    for (auto& d : hitDists) d = maxDistance;
+
+    terrain.ScanLidar(rb.mPosWS, fwdAng, 2 * probeUnit, WALL_HEIGHT, CS_LIDAR_BEAMS_N, hitDists);
+
+    for (size_t i = 0; i < (size_t)CS_LIDAR_BEAMS_N; ++i)
+    {
+        inputs[(size_t)CS_SENS_PROBE_FIRST_HITDIST + i] = hitDists[i];
+
+        if (drawDebugDotFn && hitDists[i] < maxDistance)
+        {
+            const auto ang = fwdAng + glm::two_pi<float>() * (float)i / (float)CS_LIDAR_BEAMS_N;
+            drawDebugDotFn(glm::vec3(rb.mPosWS) + hitDists[i] * glm::vec3(std::cos(ang), 0, std::sin(ang)),
+                           {1, 0, 0, 1});
+        }
+    }
+#else
     struct Probe
     {
         glm::vec3 pr_offsetLS{};
@@ -231,7 +311,6 @@ static void prepareBrainInputs(CSM_Vec& inputs, const CS_Unit& u, const glm::dve
         probes[i].pr_debugCol = primaryCols[i];
     }
 #endif
-    const auto maxDistance = terrain.GetFieldSize();
 
     // initialize to a large reference value
     for (auto& probe : probes) probe.pr_hitDist = maxDistance;
@@ -255,6 +334,18 @@ static void prepareBrainInputs(CSM_Vec& inputs, const CS_Unit& u, const glm::dve
 
     for (size_t i = 0; i < (size_t)CS_SENS_PROBES_N; ++i)
         inputs[(size_t)CS_SENS_PROBE_FIRST_HITDIST + i] = probes[i].pr_hitDist;
+#endif
+
+#ifdef CS_USE_UNIT_SENSOR
+    // distance to the nearest other unit, as a probe that hits nothing when there's none in range
+    auto unitHitDist = maxDistance;
+    pUnitGrid->ForEachNear((float)rb.mPosWS[0], (float)rb.mPosWS[2], (float)CS_Sim::UNIT_SENS_RANGE_M, unitIdx,
+                           [&](size_t, float, float, float dist) { unitHitDist = std::min(unitHitDist, dist); });
+    inputs[CS_SENS_UNIT_HITDIST] = unitHitDist;
+#else
+    (void)pUnitGrid;
+    (void)unitIdx;
+#endif
 
     // normalize to our reference value
     for (auto& in : inputs) in /= maxDistance;
@@ -262,16 +353,27 @@ static void prepareBrainInputs(CSM_Vec& inputs, const CS_Unit& u, const glm::dve
     // we do not normalize these, since they are flags, not distances
     inputs[CS_SENS_IS_OUTSIDE_MAP]  = (CS_SCALAR)(terrain.IsPosInside(rb.mPosWS) ? 0 : 1);
     inputs[CS_SENS_IS_IN_DEAD_ZONE] = (CS_SCALAR)(terrain.GetHeightFromPos(rb.mPosWS) > WALL_HEIGHT ? 1 : 0);
+
+#ifdef CS_USE_FLOW_DIR_SENSORS
+    // already a unit vector
+    const auto cell            = terrain.getCellFromPos(rb.mPosWS);
+    const auto [flowX, flowZ]  = pFlowField->GetDir(cell[0], cell[1]);
+    inputs[CS_SENS_FLOW_DIR_X] = (CS_SCALAR)flowX;
+    inputs[CS_SENS_FLOW_DIR_Z] = (CS_SCALAR)flowZ;
+#else
+    (void)pFlowField;
+#endif
 }
 
 // calculate a cost function based on the current state
-static double calcCost(const CSM_Vec& inputs, double curTimeS, double maxTimeS)
+// geoDist is the normalized distance around the walls, < 0 to use the straight line
+static double calcCost(const CSM_Vec& inputs, double geoDist, double curTimeS, double maxTimeS)
 {
     constexpr double BAD_AREA_FACTOR = 10.0; // >> of sum of other factors
 
     const auto targetPos             = glm::dvec3(inputs[CS_SENS_TARGET_X], 0, inputs[CS_SENS_TARGET_Z]);
     const auto pos                   = glm::dvec3(inputs[CS_SENS_POS_X], 0, inputs[CS_SENS_POS_Z]);
-    const auto dist                  = glm::length(targetPos - pos);
+    const auto dist                  = geoDist >= 0 ? geoDist : glm::length(targetPos - pos);
 
     const auto isOutsideMap          = inputs[CS_SENS_IS_OUTSIDE_MAP] > 0.5;
     const auto isInDeadZone          = inputs[CS_SENS_IS_IN_DEAD_ZONE] > 0.5;
@@ -285,15 +387,151 @@ static double calcCost(const CSM_Vec& inputs, double curTimeS, double maxTimeS)
     return inputs[CS_SENS_IS_OUTSIDE_MAP] > 0.5 || inputs[CS_SENS_IS_IN_DEAD_ZONE] > 0.5;
 }
 
+// the blob is this header, followed by the state of each unit
+struct SnapshotHeader
+{
+    static constexpr uint32_t MAGIC = 0x43535331; // "CSS1"
+
+    uint32_t magic;
+    uint32_t unitsN;
+    double curTimeS;
+    uint32_t isCompleted;
+};
+static_assert(std::is_trivially_copyable_v<SnapshotHeader> && std::is_trivially_copyable_v<CS_Unit::State>);
+
+std::vector<uint8_t> CS_Sim::Snapshot() const
+{
+    std::vector<uint8_t> blob(sizeof(SnapshotHeader) + moUnits.size() * sizeof(CS_Unit::State));
+
+    SnapshotHeader hdr{SnapshotHeader::MAGIC, (uint32_t)moUnits.size(), mCurTimeS, mIsCompleted};
+    memcpy(blob.data(), &hdr, sizeof(hdr));
+
+    auto* pDst = blob.data() + sizeof(hdr);
+    for (const auto& u : moUnits)
+    {
+        const auto st = u->GetState();
+        memcpy(pDst, &st, sizeof(st));
+        pDst += sizeof(st);
+    }
+    return blob;
+}
+
+bool CS_Sim::Restore(const std::vector<uint8_t>& blob)
+{
+    if (blob.size() != sizeof(SnapshotHeader) + moUnits.size() * sizeof(CS_Unit::State)) return false;
+
+    SnapshotHeader hdr;
+    memcpy(&hdr, blob.data(), sizeof(hdr));
+    if (hdr.magic != SnapshotHeader::MAGIC || hdr.unitsN != moUnits.size()) return false;
+
+    mCurTimeS    = hdr.curTimeS;
+    mIsCompleted = hdr.isCompleted != 0;
+
+    const auto* pSrc = blob.data() + sizeof(hdr);
+    for (auto& u : moUnits)
+    {
+        CS_Unit::State st;
+        memcpy(&st, pSrc, sizeof(st));
+        u->SetState(st);
+        pSrc += sizeof(st);
+    }
+    return true;
+}
+
 double CS_Sim::GetAvgTotalCost() const
 {
-    double totalCost = 0.0;
-    for (const auto& u : moUnits) totalCost += u->mFinalCost;
+    std::vector<double> epCosts(mEpisodes.size());
+    std::vector<size_t> epUnitsN(mEpisodes.size());
+    for (const auto& u : moUnits)
+    {
+        epCosts[u->mEpisodeIdx] += u->mFinalCost;
+        epUnitsN[u->mEpisodeIdx] += 1;
+    }
+
+    return reduceEpisodeCosts(epCosts, epUnitsN);
+}
+
+double CS_Sim::CalcAvgCostLowerBound() const
+{
+    const auto maxTimeS   = mPars.mMaxTimeS;
+    const auto remTimeS   = std::max(0.0, maxTimeS - mCurTimeS);
+    // the best case is to drive straight to the target at full speed
+    // (1 second of slack, since the cost may be computed from the inputs of the previous step)
+    const auto maxReachM  = CS_Unit::GetSpeedBoundMS() * (remTimeS + 1.0);
+    const auto normDist   = 1.0 / (double)mTerrain.GetFieldSize();
+    const auto minTimeSca = std::min(mCurTimeS, maxTimeS) / maxTimeS;
+
+    std::vector<double> epCosts(mEpisodes.size());
+    std::vector<size_t> epUnitsN(mEpisodes.size());
+    for (const auto& u : moUnits)
+    {
+        const auto epIdx = u->mEpisodeIdx;
+        epUnitsN[epIdx] += 1;
+        if (u->GetRunningState() != 0)
+        {
+            epCosts[epIdx] += u->mFinalCost;
+            continue;
+        }
+        const auto& pos         = u->GetRBody().mPosWS;
+        const auto& tarPos      = mEpisodes[epIdx].mTargetPos;
+        const auto distToTarget = glm::length(glm::dvec2(tarPos[0] - pos[0], tarPos[2] - pos[2]));
+        // see calcCost(), distances are normalized by the field size, and bad area factors are >= 0
+        // (also holds for the geodesic distance, never shorter than the straight line)
+        epCosts[epIdx] += std::max(0.0, distToTarget - maxReachM) * normDist + minTimeSca;
+    }
+
+    return reduceEpisodeCosts(epCosts, epUnitsN);
+}
+
+// from the sums of the costs of the units of each episode
+double CS_Sim::reduceEpisodeCosts(const std::vector<double>& epCosts, const std::vector<size_t>& epUnitsN) const
+{
+    // averages, skipping the episodes that had no room for units
+    std::vector<double> avgs;
+    for (size_t i = 0; i < epCosts.size(); ++i)
+        if (epUnitsN[i]) avgs.push_back(epCosts[i] / (double)epUnitsN[i]);
+
+    if (avgs.empty()) return 0.0;
+
+    if (mPars.mCostReduce == CostReduce::WORST) return *std::max_element(avgs.begin(), avgs.end());
+
+    if (mPars.mCostReduce == CostReduce::TRIMMED)
+    {
+        std::sort(avgs.begin(), avgs.end());
+        // keep at least one
+        const auto maxCutN = (avgs.size() - 1) / 2;
+        const auto cutN    = std::min(maxCutN, (size_t)((double)avgs.size() * mPars.mTrimFrac));
+        avgs               = std::vector<double>(avgs.begin() + (ptrdiff_t)cutN, avgs.end() - (ptrdiff_t)cutN);
+    }
+
+    double sum = 0.0;
+    for (const auto c : avgs) sum += c;
+    return sum / (double)avgs.size();
+}
+
+double CS_Sim::calcNormGeoDist(const CS_RBody::Vec3& pos, size_t epIdx) const
+{
+#ifdef CS_USE_GEODESIC_COST
+    // unreachable from walls and closed pockets, those fall back to the straight line
+    const auto cell   = mTerrain.getCellFromPos(pos);
+    const auto ffDist = mFlowFields[epIdx]->GetDist(cell[0], cell[1]);
+    return ffDist >= 0 ? (double)ffDist / (double)mTerrain.GetFieldSize() : -1.0;
+#else
+    (void)pos;
+    (void)epIdx;
+    return -1.0;
+#endif
+}
+
+CS_RBody::Vec3 CS_Sim::CalcAvgUnitsPos() const
+{
+    CS_RBody::Vec3 sum{0, 0, 0};
+    for (const auto& u : moUnits) sum += u->GetRBody().mPosWS;
 
-    return totalCost / std::max(1.0, (double)moUnits.size());
+    return sum / (CS_RBody::Scalar)std::max((size_t)1, moUnits.size());
 }
 
-void CS_Sim::AnimSim(double intervalS, bool doDraw)
+void CS_Sim::AnimSim(double intervalS, bool doDraw, const CS_SCALAR* pControls)
 {
     // update the completed status
     mIsCompleted = (countRunning() == 0) || (mCurTimeS >= mPars.mMaxTimeS);
@@ -304,6 +542,7 @@ void CS_Sim::AnimSim(double intervalS, bool doDraw)
     std::function<void(const glm::vec3&, const glm::vec4&)> drawDebugDot;
     if (doDraw)
     {
+        CS_PROF_SCOPE(CS_PROF_DEBUG_DRAW);
         // highlight the selected unit, if any
         const auto liveTimeS = ut::GetSteadyTimeS();
         const auto selColSca = (float)(sin(liveTimeS * 7) + 2.0);
@@ -321,60 +560,298 @@ void CS_Sim::AnimSim(double intervalS, bool doDraw)
     // nothing else to do if the simulation is completed
     if (mIsCompleted) return;
 
-    // preallocate inputs and outputs
-    CS_SCALAR inputsBuff[CS_SENS_N];
-    CS_SCALAR outputsBuff[CS_CTRL_N];
-    CSM_Vec inputs(inputsBuff, CS_SENS_N);   // UNINITIALIZED
-    CSM_Vec outputs(outputsBuff, CS_CTRL_N); // UNINITIALIZED
+    // units only read the terrain and write their own state, so big sims can step them in parallel,
+    // in static chunks of contiguous units
+    const auto unitsN    = moUnits.size();
+    const auto chunksN   = prepareChunks(unitsN);
+    const auto chunkSize = (unitsN + chunksN - 1) / chunksN;
 
-    auto onUnitEnd = [&](const auto& u, const auto& inputs, bool assumeTimeout, int state) {
-        u->SetRunningState(state);
-        const auto useTimeS = assumeTimeout ? mPars.mMaxTimeS : mCurTimeS;
-        u->mFinalCost       = calcCost(inputs, useTimeS, mPars.mMaxTimeS);
+    // debug dots are collected by each chunk, then drawn in the order of the units
+    struct DebugDot
+    {
+        glm::vec3 pos;
+        glm::vec4 col;
     };
+    std::vector<std::vector<DebugDot>> chunksDots(drawDebugDot ? chunksN : 0);
 
-    // animate all of the units
-    for (size_t i = 0; i < moUnits.size(); ++i)
+    // where the running units are at the start of the step
+    if (moUnitGrid)
     {
-        const auto& u = moUnits[i];
+        CS_PROF_SCOPE(CS_PROF_UNIT_GRID);
+        moUnitGrid->Build(
+            unitsN, [&](size_t i) { return moUnits[i]->GetRBody().mPosWS; },
+            [&](size_t i) { return moUnits[i]->GetRunningState() == 0; });
+
+        if (mPars.mUnitCollisions) separateUnits();
+    }
 
-        // always start with zeros in inputs and outputs
-        inputs.ZeroFill();
-        outputs.ZeroFill();
+    if (mChunkScratches.size() < chunksN) mChunkScratches.resize(chunksN);
 
-        // setup the input variables for the brain
-        prepareBrainInputs(inputs, *u, mPars.mTargetPos, mTerrain, drawDebugDot);
+    runChunks(chunksN, [&](size_t chunkIdx) {
+        std::function<void(const glm::vec3&, const glm::vec4&)> chunkDrawDebugDot;
+        if (drawDebugDot)
+            chunkDrawDebugDot = [&dots = chunksDots[chunkIdx]](const glm::vec3& pos, const glm::vec4& col) {
+                dots.push_back({pos, col});
+            };
 
-        if (u->GetRunningState() != 0) continue;
+        const auto sta = chunkIdx * chunkSize;
+        const auto end = std::min(unitsN, sta + chunkSize);
 
-        // we know this from here
-        if (hasCrashed(inputs))
+        auto& scr = mChunkScratches[chunkIdx];
+        scr.mInputs.resize((end - sta) * CS_SENS_N);
+        scr.mOutputs.resize((end - sta) * CS_CTRL_N);
+        scr.mRunIdxs.clear();
+        auto& inputsBuff  = scr.mInputs;
+        auto& outputsBuff = scr.mOutputs;
+        auto& runIdxs     = scr.mRunIdxs;
+
+        // sense for each unit, think for all of them in one call to the brain, then act for each unit
         {
-            onUnitEnd(u, inputs, false, -1);
-            continue;
+            CS_PROF_SCOPE(CS_PROF_SENSE);
+            for (size_t i = sta; i < end; ++i)
+            {
+                CSM_Vec inputs(inputsBuff.data() + runIdxs.size() * CS_SENS_N, CS_SENS_N);
+                if (senseUnit(i, inputs, chunkDrawDebugDot)) runIdxs.push_back(i);
+            }
         }
-        if (u->IsNotMoving())
+
+        const auto runN = runIdxs.size();
+        // execute the default brain, unless the controls come from the outside
+        if (pControls)
         {
-            onUnitEnd(u, inputs, true, -1);
-            continue;
+            for (size_t k = 0; k < runN; ++k)
+                std::copy_n(pControls + runIdxs[k] * CS_CTRL_N, CS_CTRL_N, outputsBuff.data() + k * CS_CTRL_N);
+        }
+        else
+        {
+            CS_PROF_SCOPE(CS_PROF_BRAIN);
+            mBrain.AnimateBrainBatch(runN, inputsBuff.data(), CS_SENS_N, outputsBuff.data(), CS_CTRL_N);
         }
 
-        // execute the default brain
-        mBrain.AnimateBrain(inputs, outputs);
+        // the units are independent, so all the physics then all the checks is the same as unit by unit
+        // (and the clock is read once per chunk, not per unit)
+        {
+            CS_PROF_SCOPE(CS_PROF_PHYSICS);
+            for (size_t k = 0; k < runN; ++k)
+                actUnit(runIdxs[k], intervalS, CSM_Vec(outputsBuff.data() + k * CS_CTRL_N, CS_CTRL_N));
+        }
+        {
+            CS_PROF_SCOPE(CS_PROF_END_CHECK);
+            for (size_t k = 0; k < runN; ++k)
+                checkUnitEnd(runIdxs[k], CSM_Vec(inputsBuff.data() + k * CS_SENS_N, CS_SENS_N));
+        }
+    });
 
-        // apply the brain outputs as inputs to the unit
-        u->SetControlValues(outputs);
+    if (moRecorder) recordStep();
 
-        // run the simulation step
-        u->AnimateUnit(mCurTimeS, intervalS);
+    if (drawDebugDot)
+    {
+        CS_PROF_SCOPE(CS_PROF_DEBUG_DRAW);
+        for (const auto& dots : chunksDots)
+            for (const auto& dot : dots) drawDebugDot(dot.pos, dot.col);
+    }
+}
 
-        // we know this right after the simulation step
-        {
-            const auto distoToTarget = glm::distance(u->GetRBody().mPosWS, mPars.mTargetPos);
-            if (distoToTarget < 1.0) onUnitEnd(u, inputs, false, 1);               // success
-            else if (mCurTimeS > mPars.mMaxTimeS) onUnitEnd(u, inputs, false, -1); // fail
-        }
+// setup the inputs of the brain, false if the unit is not running (anymore)
+bool CS_Sim::senseUnit(size_t unitIdx, CSM_Vec& inputs,
+                       const std::function<void(const glm::vec3&, const glm::vec4&)>& drawDebugDot)
+{
+    auto& u = *moUnits[unitIdx];
+
+    // always start with zeros in inputs
+    inputs.ZeroFill();
+
+    // setup the input variables for the brain
+    const auto epIdx = u.mEpisodeIdx;
+    const auto* pFF  = mFlowFields.empty() ? nullptr : mFlowFields[epIdx].get();
+    prepareBrainInputs(inputs, u, mEpisodes[epIdx].mTargetPos, mTerrain, pFF, moUnitGrid.get(), unitIdx,
+                       drawDebugDot);
+
+    if (u.GetRunningState() != 0) return false;
+
+    // we know this from here
+    if (hasCrashed(inputs))
+    {
+        endUnit(u, inputs, false, -1);
+        return false;
+    }
+    if (u.IsNotMoving())
+    {
+        endUnit(u, inputs, true, -1);
+        return false;
+    }
+    return true;
+}
+
+void CS_Sim::actUnit(size_t unitIdx, double intervalS, const CSM_Vec& outputs)
+{
+    auto& u = *moUnits[unitIdx];
+
+    // apply the brain outputs as inputs to the unit
+    u.SetControlValues(outputs);
+
+    // run the simulation step
+    u.AnimateUnit(mCurTimeS, intervalS);
+}
+
+// we know this right after the simulation step
+void CS_Sim::checkUnitEnd(size_t unitIdx, const CSM_Vec& inputs)
+{
+    auto& u = *moUnits[unitIdx];
+
+    const auto distoToTarget = glm::distance(u.GetRBody().mPosWS, mEpisodes[u.mEpisodeIdx].mTargetPos);
+    if (distoToTarget < 1.0) endUnit(u, inputs, false, 1);               // success
+    else if (mCurTimeS > mPars.mMaxTimeS) endUnit(u, inputs, false, -1); // fail
+}
+
+void CS_Sim::endUnit(CS_Unit& u, const CSM_Vec& inputs, bool assumeTimeout, int state)
+{
+    u.SetRunningState(state);
+    const auto useTimeS = assumeTimeout ? mPars.mMaxTimeS : mCurTimeS;
+    const auto geoDist  = calcNormGeoDist(u.GetRBody().mPosWS, u.mEpisodeIdx);
+    u.mFinalCost        = calcCost(inputs, geoDist, useTimeS, mPars.mMaxTimeS);
+}
+
+bool CS_Sim::StartRecording(const std::string& fname)
+{
+    moRecorder = std::make_unique<CS_TrajRecorder>(fname, moUnits.size());
+    if (!moRecorder->IsOpen())
+    {
+        moRecorder.reset();
+        return false;
+    }
+    mRecSamples.resize(moUnits.size());
+    return true;
+}
+
+void CS_Sim::StopRecording()
+{
+    // the writer finishes the last chunk
+    moRecorder.reset();
+}
+
+// only quantized into the recorder's buffer here, encoded and written in the background
+void CS_Sim::recordStep()
+{
+    for (size_t i = 0; i < moUnits.size(); ++i) mRecSamples[i] = GetUnitPose(i);
+
+    moRecorder->AddStep(mCurTimeS, mRecSamples.data());
+}
+
+CS_TrajSample CS_Sim::GetUnitPose(size_t unitIdx) const
+{
+    const auto& u  = *moUnits[unitIdx];
+    const auto& rb = u.GetRBody();
+
+    CS_TrajSample pose;
+    pose.mPosX         = (float)rb.mPosWS[0];
+    pose.mPosZ         = (float)rb.mPosWS[2];
+    pose.mYaw          = (float)calcYaw(getFwdVecNorm(rb.GetRotWS_LS()));
+    pose.mFinalCost    = (float)u.mFinalCost;
+    pose.mRunningState = u.GetRunningState();
+    for (size_t j = 0; j < CS_CTRL_N; ++j) pose.mControls[j] = u.GetControlValue((CS_ControlType)j);
+    return pose;
+}
+
+void CS_Sim::SetUnitPose(size_t unitIdx, const CS_TrajSample& pose)
+{
+    auto& u                = *moUnits[unitIdx];
+    auto st                = u.GetState();
+
+    // only a yaw, the forward vector is -Z rotated by it (see calcYaw())
+    const auto rotY        = glm::rotate(glm::dmat4(1), (double)pose.mYaw + glm::pi<double>(), glm::dvec3(0, 1, 0));
+    st.mRBody.mPosWS       = CS_RBody::Vec3(pose.mPosX, st.mRBody.mPosWS[1], pose.mPosZ);
+    st.mRBody.mCurRotWS_LS = CS_RBody::Mat3(rotY);
+    st.mRunningState       = pose.mRunningState;
+    st.mFinalCost          = pose.mFinalCost;
+    std::copy(std::begin(pose.mControls), std::end(pose.mControls), st.mControls);
+    u.SetState(st);
+}
+
+int CS_Sim::GetUnitRunningState(size_t unitIdx) const
+{
+    return moUnits[unitIdx]->GetRunningState();
+}
+
+void CS_Sim::CalcUnitInputs(size_t unitIdx, CSM_Vec& inputs) const
+{
+    const auto& u    = *moUnits[unitIdx];
+    const auto epIdx = u.mEpisodeIdx;
+    const auto* pFF  = mFlowFields.empty() ? nullptr : mFlowFields[epIdx].get();
+
+    inputs.ZeroFill();
+    prepareBrainInputs(inputs, u, mEpisodes[epIdx].mTargetPos, mTerrain, pFF, moUnitGrid.get(), unitIdx, {});
+}
+
+double CS_Sim::CalcUnitCost(size_t unitIdx, const CSM_Vec& inputs) const
+{
+    const auto& u = *moUnits[unitIdx];
+    if (u.GetRunningState() != 0) return u.mFinalCost;
+
+    const auto geoDist = calcNormGeoDist(u.GetRBody().mPosWS, u.mEpisodeIdx);
+    return calcCost(inputs, geoDist, mCurTimeS, mPars.mMaxTimeS);
+}
+
+// push apart the running units that overlap, and stop them from moving into each other
+// all from the positions at the start of the step, so that the order of the units doesn't matter
+void CS_Sim::separateUnits()
+{
+    const auto unitsN  = moUnits.size();
+    const auto minDist = (float)(UNIT_RADIUS_M * 2);
+
+    std::vector<CS_RBody::Vec3> pushes(unitsN, CS_RBody::Vec3(0, 0, 0));
+    auto calcPush = [&](size_t i) {
+        if (moUnits[i]->GetRunningState() != 0) return;
+
+        const auto& pos = moUnits[i]->GetRBody().mPosWS;
+        auto onNear     = [&](size_t j, float dx, float dz, float dist) {
+            // each takes half of the overlap, units on the same spot go opposite ways by index
+            const auto dir = dist > 1e-4f ? CS_RBody::Vec3(dx / dist, 0, dz / dist)
+                                          : CS_RBody::Vec3(j > i ? 1 : -1, 0, 0);
+            pushes[i] -= dir * (CS_RBody::Scalar)((minDist - dist) * 0.5f);
+        };
+        moUnitGrid->ForEachNear((float)pos[0], (float)pos[2], minDist, i, onNear);
+    };
+    const auto chunksN   = prepareChunks(unitsN);
+    const auto chunkSize = (unitsN + chunksN - 1) / chunksN;
+    runChunks(chunksN, [&](size_t chunkIdx) {
+        for (size_t i = chunkIdx * chunkSize; i < std::min(unitsN, (chunkIdx + 1) * chunkSize); ++i) calcPush(i);
+    });
+
+    for (size_t i = 0; i < unitsN; ++i)
+    {
+        const auto pushLen = glm::length(pushes[i]);
+        if (pushLen <= 0) continue;
+
+        auto& rb = moUnits[i]->GetRBody();
+        rb.mPosWS += pushes[i];
+
+        // no velocity against the push
+        const auto dir  = pushes[i] / pushLen;
+        const auto velN = glm::dot(rb.mVelWS, dir);
+        if (velN < 0) rb.mVelWS -= dir * velN;
+    }
+}
+
+// the units are split in this many chunks: one per core for the big sims, unless the sim is already on a worker
+// (i.e. evaluated by the trainer), where the cores are taken by the other sims
+size_t CS_Sim::prepareChunks(size_t n)
+{
+    const auto coresN = CS_GetCoresN();
+    if (n < PARALLEL_MIN_UNITS_N || coresN <= 1 || CS_IsInWorker()) return 1;
+
+    if (!moPool) moPool = std::make_unique<CS_WorkerPool>(coresN - 1);
+    return std::min(coresN, n);
+}
+
+void CS_Sim::runChunks(size_t chunksN, const std::function<void(size_t)>& fn)
+{
+    if (chunksN <= 1)
+    {
+        fn(0);
+        return;
     }
+    moPool->RunChunks(chunksN, fn);
 }
 
 size_t CS_Sim::countRunning() const
@@ -516,7 +993,7 @@ void CS_Sim::drawSelectedUI()
     const auto& rb         = u.GetRBody();
     const auto fwd         = getFwdVecNorm(rb.GetRotWS_LS());
     const auto curYaw      = calcYaw(fwd);
-    const auto yawToTarget = calcYawToTarget(fwd, rb.mPosWS, mPars.mTargetPos);
+    const auto yawToTarget = calcYawToTarget(fwd, rb.mPosWS, mEpisodes[u.mEpisodeIdx].mTargetPos);
 
     et.AddText("Pos");
     et.AddText(glm::to_string(rb.mPosWS));
@@ -7,8 +7,12 @@
 /*     2022/06/26       */
 /************************/
 
+#include <cstdint>
+#include <functional>
 #include <memory>
+#include <string>
 #include <vector>
+#include <glm/vec4.hpp>
 #include "cs_brainbase.h"
 #include "cs_rbody.h"
 #include "cs_serialize_fwd.h"
@@ -22,18 +26,56 @@ namespace ge
 
 class CS_Unit;
 class CS_Terrain;
+class CS_FlowField;
+class CS_UnitGrid;
+class CS_TrajRecorder;
+class CS_WorkerPool;
+struct CS_TrajSample;
 
 class CS_Sim
 {
   public:
     static constexpr double WALL_HEIGHT = 0.5;
+    // from this many units, they are stepped in parallel (unless the sim is already on a worker, see CS_IsInWorker())
+    static constexpr size_t PARALLEL_MIN_UNITS_N = 64;
+    // radius of a unit for the collisions, and range of the sensor of the other units
+    static constexpr double UNIT_RADIUS_M     = 0.5;
+    static constexpr double UNIT_SENS_RANGE_M = 5.0;
+    // bump when a change in the simulation changes the costs (invalidates cached costs)
+#ifdef CS_USE_GEODESIC_COST
+    static constexpr uint32_t CODE_VERSION = 2;
+#else
+    static constexpr uint32_t CODE_VERSION = 1;
+#endif
+
+    // how the costs of the episodes make the cost of the sim
+    enum class CostReduce : int {
+        MEAN,
+        WORST,
+        TRIMMED, // mean without the best and the worst mTrimFrac of the episodes
+    };
+
+    struct Episode
+    {
+        CS_RBody::Vec3 mStartPos{0, 0, 0};
+        CS_RBody::Vec3 mTargetPos{0, 0, 0};
+
+        friend void to_json(nlohmann::json& j, const Episode& v);
+        friend void from_json(const nlohmann::json& j, Episode& v);
+    };
 
     struct Params
     {
         size_t mInitUnitsN = 10;
         CS_RBody::Vec3 mStartPos{0, 0, 0};
         CS_RBody::Vec3 mTargetPos{0, 0, 0};
+        // start/target pairs run together, mInitUnitsN units each (if empty, the one above)
+        std::vector<Episode> mEpisodes;
+        CostReduce mCostReduce = CostReduce::MEAN;
+        double mTrimFrac       = 0.2;
         double mMaxTimeS{};
+        // units push each other apart, rather than passing through
+        bool mUnitCollisions{};
 
         friend void to_json(nlohmann::json& j, const Params& v);
         friend void from_json(const nlohmann::json& j, Params& v);
@@ -48,32 +90,106 @@ class CS_Sim
 
     static double GetWallHeight_s() { return WALL_HEIGHT; }
 
+    // average cost of the units of each episode, reduced by mCostReduce
     double GetAvgTotalCost() const;
 
+    // lower bound of what GetAvgTotalCost() can be once the simulation is complete
+    // (the reduction is monotone, so it can be applied to the lower bounds of the episodes)
+    double CalcAvgCostLowerBound() const;
+
+    const auto& GetEpisodes() const { return mEpisodes; }
+
+    // average position of the units, as a behavior descriptor
+    CS_RBody::Vec3 CalcAvgUnitsPos() const;
+
     double GetCurSimTimeS() const { return mCurTimeS; }
+    void SetCurSimTimeS(double timeS) { mCurTimeS = timeS; }
 
-    void AnimSim(double intervalS, bool doDraw);
+    // pControls, if set, are CS_CTRL_N values per unit that replace the outputs of the brain
+    void AnimSim(double intervalS, bool doDraw, const CS_SCALAR* pControls = nullptr);
 
-    void SetCompleted() { mIsCompleted = true; }
+    // per unit access, for stepping from the outside (see CS_VecEnv)
+    size_t GetUnitsN() const { return moUnits.size(); }
+    // 0 running, 1 success, -1 failed
+    int GetUnitRunningState(size_t unitIdx) const;
+    // the inputs that the brain sees at the next step (CS_SENS_N)
+    void CalcUnitInputs(size_t unitIdx, CSM_Vec& inputs) const;
+    // the final cost once ended, otherwise the cost if it ended now
+    double CalcUnitCost(size_t unitIdx, const CSM_Vec& inputs) const;
+
+    // what is shown of a unit, the same as what's recorded, to replay a run without simulating it
+    CS_TrajSample GetUnitPose(size_t unitIdx) const;
+    // places the unit, with no simulation
+    void SetUnitPose(size_t unitIdx, const CS_TrajSample& pose);
+
+    void SetCompleted(bool isCompleted = true) { mIsCompleted = isCompleted; }
+
+    // the state of the units and the time, as a plain blob, to fork rollouts from a shared prefix or to checkpoint
+    // it can be restored into any sim made with the same params and terrain (the brain may differ)
+    std::vector<uint8_t> Snapshot() const;
+    // false if the blob doesn't match this sim (i.e. different units)
+    bool Restore(const std::vector<uint8_t>& blob);
 
     bool IsSimComplete() const { return mIsCompleted; }
 
+    // stream the trajectories of all the units to a file, at every step (see CS_TrajReader)
+    // false if the file can't be created
+    bool StartRecording(const std::string& fname);
+    void StopRecording();
+
     void AddMeshesToSceneSim(ge::Scene& scene) const;
     void OnPickedMeshSim(const ge::Mesh* pMesh);
     void DrawSimParamsUI();
     void DrawSimUI();
 
   private:
+    void ctor_addEpisodeUnits(size_t epIdx, bool createDisp);
+    bool senseUnit(size_t unitIdx, CSM_Vec& inputs,
+                   const std::function<void(const glm::vec3&, const glm::vec4&)>& drawDebugDot);
+    void actUnit(size_t unitIdx, double intervalS, const CSM_Vec& outputs);
+    void checkUnitEnd(size_t unitIdx, const CSM_Vec& inputs);
+    void endUnit(CS_Unit& u, const CSM_Vec& inputs, bool assumeTimeout, int state);
+    void separateUnits();
+    size_t prepareChunks(size_t n);
+    void runChunks(size_t chunksN, const std::function<void(size_t)>& fn);
+    void recordStep();
+    double reduceEpisodeCosts(const std::vector<double>& epCosts, const std::vector<size_t>& epUnitsN) const;
     void drawSimStatusUI();
     void drawSelectedUI();
     size_t countRunning() const;
     size_t countSuccess() const;
     size_t countFailed() const;
     size_t countMax() const;
+    // normalized distance to the target around the walls, < 0 if not available
+    double calcNormGeoDist(const CS_RBody::Vec3& pos, size_t epIdx) const;
 
   private:
     std::vector<std::unique_ptr<CS_Unit>> moUnits;
 
+    std::vector<Episode> mEpisodes;
+
+    // paths to the target of each episode, owned by the terrain's cache (only if the cost or the sensors need it)
+    std::vector<std::shared_ptr<const CS_FlowField>> mFlowFields;
+
+    // positions of the running units, for collisions and sensors (only if needed)
+    std::unique_ptr<CS_UnitGrid> moUnitGrid;
+
+    std::unique_ptr<CS_TrajRecorder> moRecorder;
+    std::vector<CS_TrajSample> mRecSamples;
+
+    // inputs and outputs of the running units of each chunk of AnimSim(), as contiguous rows
+    // (kept from step to step, so that a step doesn't allocate)
+    struct ChunkScratch
+    {
+        std::vector<CS_SCALAR> mInputs;
+        std::vector<CS_SCALAR> mOutputs;
+        std::vector<size_t> mRunIdxs;
+    };
+    std::vector<ChunkScratch> mChunkScratches;
+
+    // threads for the chunks, created by the first step that needs them
+    std::unique_ptr<CS_WorkerPool> moPool;
+
     double mCurTimeS{};
     bool mIsCompleted{};
 
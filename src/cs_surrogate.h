@@ -0,0 +1,154 @@
+#ifndef CS_SURROGATE_H
+#define CS_SURROGATE_H
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <random>
+#include <vector>
+#include "cs_chromo.h"
+
+// cheap estimate of the cost of a chromosome, from the costs of the nearest ones evaluated so far
+// chromosomes (as arrays of scalars) are reduced to a few features by a fixed random projection
+template <typename T> class CS_Surrogate
+{
+    static constexpr size_t FEATURES_N = 16;
+    static constexpr size_t NEAREST_N  = 8;
+
+    using Features                     = std::array<float, FEATURES_N>;
+
+    const size_t mMaxSamplesN;
+
+    std::vector<float> mProj; // FEATURES_N x chromosome size
+    std::vector<Features> mSampleFeats;
+    std::vector<double> mSampleCosts;
+    size_t mNextSampleIdx{};
+
+  public:
+    CS_Surrogate(size_t maxSamplesN = 5000) : mMaxSamplesN(maxSamplesN) {}
+
+    size_t GetSamplesN() const { return mSampleCosts.size(); }
+
+    // forget the samples (i.e. when their costs are no longer comparable with the new ones)
+    void ClearSamples()
+    {
+        mSampleFeats.clear();
+        mSampleCosts.clear();
+        mNextSampleIdx = 0;
+    }
+
+    // once full, the oldest samples are replaced
+    void AddSample(const CS_Chromo& chromo, double cost)
+    {
+        // the projection is made on the first sample, when the size is known
+        if (mProj.empty()) makeProjection(chromo.GetChromoDataSize<T>());
+
+        const auto feats = makeFeatures(chromo);
+        if (mSampleCosts.size() < mMaxSamplesN)
+        {
+            mSampleFeats.push_back(feats);
+            mSampleCosts.push_back(cost);
+            return;
+        }
+        mSampleFeats[mNextSampleIdx] = feats;
+        mSampleCosts[mNextSampleIdx] = cost;
+        mNextSampleIdx               = (mNextSampleIdx + 1) % mMaxSamplesN;
+    }
+
+    // inverse distance weighted mean of the nearest samples
+    double PredictCost(const CS_Chromo& chromo) const
+    {
+        if (mSampleCosts.empty()) return 0.0;
+
+        const auto feats = makeFeatures(chromo);
+
+        std::vector<std::pair<float, size_t>> dists(mSampleFeats.size());
+        for (size_t i = 0; i < mSampleFeats.size(); ++i)
+        {
+            float d2 = 0;
+            for (size_t f = 0; f < FEATURES_N; ++f)
+            {
+                const auto d = feats[f] - mSampleFeats[i][f];
+                d2 += d * d;
+            }
+            dists[i] = {d2, i};
+        }
+        const auto n = std::min(NEAREST_N, dists.size());
+        std::partial_sort(dists.begin(), dists.begin() + (ptrdiff_t)n, dists.end());
+
+        double sumW = 0;
+        double sumC = 0;
+        for (size_t i = 0; i < n; ++i)
+        {
+            const auto w = 1.0 / (std::sqrt((double)dists[i].first) + 1e-6);
+            sumW += w;
+            sumC += w * mSampleCosts[dists[i].second];
+        }
+        return sumC / sumW;
+    }
+
+    // Spearman's rank correlation, 1 when b orders the elements as a does
+    static double CalcRankCorrelation(const std::vector<double>& a, const std::vector<double>& b)
+    {
+        const auto n = a.size();
+        if (n < 2 || b.size() != n) return 0.0;
+
+        const auto ra = calcRanks(a);
+        const auto rb = calcRanks(b);
+
+        const auto mean = (double)(n - 1) / 2;
+        double cov = 0, varA = 0, varB = 0;
+        for (size_t i = 0; i < n; ++i)
+        {
+            cov += (ra[i] - mean) * (rb[i] - mean);
+            varA += (ra[i] - mean) * (ra[i] - mean);
+            varB += (rb[i] - mean) * (rb[i] - mean);
+        }
+        return (varA > 0 && varB > 0) ? cov / std::sqrt(varA * varB) : 0.0;
+    }
+
+  private:
+    Features makeFeatures(const CS_Chromo& chromo) const
+    {
+        const auto* p = chromo.GetChromoData<T>();
+        const auto n  = std::min(chromo.GetChromoDataSize<T>(), mProj.size() / FEATURES_N);
+
+        Features feats{};
+        for (size_t f = 0; f < FEATURES_N; ++f)
+        {
+            const auto* pRow = mProj.data() + f * (mProj.size() / FEATURES_N);
+            float sum        = 0;
+            for (size_t i = 0; i < n; ++i) sum += pRow[i] * (float)p[i];
+            feats[f] = sum;
+        }
+        return feats;
+    }
+
+    void makeProjection(size_t n)
+    {
+        std::mt19937 rng(1234);
+        std::normal_distribution<float> nor(0.0f, 1.0f / std::sqrt((float)std::max((size_t)1, n)));
+        mProj.resize(FEATURES_N * n);
+        for (auto& x : mProj) x = nor(rng);
+    }
+
+    // ranks from 0, with ties sharing their mean rank
+    static std::vector<double> calcRanks(const std::vector<double>& vals)
+    {
+        std::vector<size_t> order(vals.size());
+        for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+        std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return vals[a] < vals[b]; });
+
+        std::vector<double> ranks(vals.size());
+        for (size_t i = 0; i < order.size();)
+        {
+            size_t j = i;
+            while (j + 1 < order.size() && vals[order[j + 1]] == vals[order[i]]) ++j;
+            for (size_t k = i; k <= j; ++k) ranks[order[k]] = (double)(i + j) / 2;
+            i = j + 1;
+        }
+        return ranks;
+    }
+};
+
+#endif
@@ -4,6 +4,9 @@
 /*     2023/02/09       */
 /************************/
 
+#include <cfloat>
+#include <climits>
+#include <glm/gtc/constants.hpp>
 #include "cs_terrain.h"
 #include "ge_mesh2.h"
 #include "geomprocessing.h"
@@ -32,6 +35,8 @@ CS_Terrain::CS_Terrain(const Params& par) : mCellSize(par.tp_fieldSize / TEX_SIZ
     if (mPar.tp_useImage) ctor_makeHeightsFromImage();
     else ctor_makeHeightsFromNoise();
 
+    ctor_makeTileMaxHeights();
+
     moMeshF->OnGeometryUpdate();
 
     moMeshF->GetMaterial().mSpecularCol  = {0.1f, 0.1f, 0.1f};
@@ -108,6 +113,21 @@ void CS_Terrain::ctor_makeHeightsFromNoise()
 
 void CS_Terrain::ctor_makeHeightsFromImage() {}
 
+void CS_Terrain::ctor_makeTileMaxHeights()
+{
+    mTileMaxHeights.assign(TILES_N * TILES_N, 0.f);
+    if (mHeights.size() != TEX_SIZ * TEX_SIZ) return;
+
+    for (size_t z = 0; z < TEX_SIZ; ++z)
+    {
+        for (size_t x = 0; x < TEX_SIZ; ++x)
+        {
+            auto& tileH = mTileMaxHeights[(x >> TILE_SIZ_L2) + (z >> TILE_SIZ_L2) * TILES_N];
+            tileH       = std::max(tileH, mHeights[x + z * TEX_SIZ]);
+        }
+    }
+}
+
 void CS_Terrain::AddMeshesToSceneTerr(ge::Scene& scene)
 {
     // render the grid
@@ -167,6 +187,125 @@ bool CS_Terrain::IsPosInside(const glm::vec3& pos) const
     return cell[0] >= 0 && (size_t)cell[0] < TEX_SIZ && cell[1] >= 0 && (size_t)cell[1] < TEX_SIZ;
 }
 
+std::shared_ptr<const CS_FlowField> CS_Terrain::GetFlowField(const glm::vec3& targetPos, float wallHeight) const
+{
+    const auto cell = getCellFromPos(targetPos);
+    const auto key  = std::make_tuple(cell[0], cell[1], wallHeight);
+
+    // built under the lock, the other sims wanting it have to wait anyway
+    std::lock_guard<std::mutex> lock(mFlowFieldsMutex);
+    auto& field = mFlowFields[key];
+    if (!field)
+        field = std::make_shared<const CS_FlowField>(mHeights.data(), TEX_SIZ, TEX_SIZ, mCellSize, wallHeight,
+                                                     cell[0], cell[1]);
+    return field;
+}
+
+// without the library call of std::floor()
+static inline int floorToInt(float x)
+{
+    const auto i = (int)x;
+    return i - (x < (float)i);
+}
+
+// fn(ix, iz, tSta, tEnd) for each square of size siz crossed by x + dx * t, z + dz * t, for t in [tSta, tEnd],
+// in order, until it returns false (t is absolute, so a coarse and a fine walk of the same ray line up)
+template <typename FN>
+static inline void walkGrid(float x, float z, float dx, float dz, float tSta, float tEnd, float siz, const FN& fn)
+{
+    const auto ooSiz = 1.f / siz;
+    auto ix          = floorToInt((x + dx * tSta) * ooSiz);
+    auto iz          = floorToInt((z + dz * tSta) * ooSiz);
+    const auto stepX = dx > 0 ? 1 : -1;
+    const auto stepZ = dz > 0 ? 1 : -1;
+    const auto dtX   = dx != 0 ? siz / std::abs(dx) : FLT_MAX;
+    const auto dtZ   = dz != 0 ? siz / std::abs(dz) : FLT_MAX;
+    auto tNextX      = dx != 0 ? ((float)(ix + (dx > 0)) * siz - x) / dx : FLT_MAX;
+    auto tNextZ      = dz != 0 ? ((float)(iz + (dz > 0)) * siz - z) / dz : FLT_MAX;
+
+    for (auto t = tSta; t <= tEnd;)
+    {
+        const auto tExit = std::min(tNextX, tNextZ);
+        if (!fn(ix, iz, t, std::min(tExit, tEnd))) return;
+
+        t = tExit;
+        if (tNextX < tNextZ)
+        {
+            ix += stepX;
+            tNextX += dtX;
+        }
+        else
+        {
+            iz += stepZ;
+            tNextZ += dtZ;
+        }
+    }
+}
+
+void CS_Terrain::ScanLidar(const glm::vec3& pos, float staAngle, float range, float wallHeight, size_t beamsN,
+                           float* pOutDists) const
+{
+    if (!beamsN) return;
+
+    // the directions of the beams from 0, made once for each beams count used by the thread
+    thread_local std::vector<glm::vec2> tBeamDirs;
+    if (tBeamDirs.size() != beamsN)
+    {
+        tBeamDirs.resize(beamsN);
+        for (size_t b = 0; b < beamsN; ++b)
+        {
+            const auto ang = glm::two_pi<double>() * (double)b / (double)beamsN;
+            tBeamDirs[b]   = {(float)std::cos(ang), (float)std::sin(ang)};
+        }
+    }
+    const auto rotC = std::cos(staAngle);
+    const auto rotS = std::sin(staAngle);
+
+    // in units of cells, cell c covers [c, c + 1) (see getCellFromPos_NoClamp())
+    const auto cellsOrig = -mPar.tp_fieldSize / 2 + mCellSize * 0.5f;
+    const auto gx        = (pos[0] - cellsOrig) / mCellSize;
+    const auto gz        = (pos[2] - cellsOrig) / mCellSize;
+    const auto rangeC    = range / mCellSize;
+
+    auto isHitCell = [&](int cx, int cz) {
+        if (cx < 0 || cx >= (int)TEX_SIZ || cz < 0 || cz >= (int)TEX_SIZ) return true;
+        return mHeights[(size_t)cx + (size_t)cz * TEX_SIZ] > wallHeight;
+    };
+    // tiles in the map with no walls are crossed in one go
+    auto isEmptyTile = [&](int tx, int tz) {
+        if (tx < 0 || tx >= (int)TILES_N || tz < 0 || tz >= (int)TILES_N) return false;
+        return mTileMaxHeights[(size_t)tx + (size_t)tz * TILES_N] <= wallHeight;
+    };
+
+    for (size_t b = 0; b < beamsN; ++b)
+    {
+        const auto& bd = tBeamDirs[b];
+        const auto dx  = rotC * bd[0] - rotS * bd[1];
+        const auto dz  = rotS * bd[0] + rotC * bd[1];
+
+        // the first cell hit, walking the cells only through the tiles with walls
+        auto hitCX = INT_MIN;
+        auto hitCZ = INT_MIN;
+        walkGrid(gx, gz, dx, dz, 0.f, rangeC, (float)(1 << TILE_SIZ_L2), [&](int tx, int tz, float t0, float t1) {
+            if (isEmptyTile(tx, tz)) return true;
+
+            walkGrid(gx, gz, dx, dz, t0, t1, 1.f, [&](int cx, int cz, float, float) {
+                if (!isHitCell(cx, cz)) return true;
+                hitCX = cx;
+                hitCZ = cz;
+                return false;
+            });
+            return hitCX == INT_MIN;
+        });
+        if (hitCX == INT_MIN) continue;
+
+        // distance to the cell's center, as for ScanRay()
+        const auto cdx = ((float)hitCX + 0.5f - gx) * mCellSize;
+        const auto cdz = ((float)hitCZ + 0.5f - gz) * mCellSize;
+        pOutDists[b]   = std::min(pOutDists[b], std::sqrt(cdx * cdx + cdz * cdz));
+    }
+}
+
 glm::vec2 CS_Terrain::getUVFromPos(const glm::vec3& pos) const
 {
     const auto hsiz     = mPar.tp_fieldSize / 2;
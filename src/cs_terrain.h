@@ -9,8 +9,13 @@
 
 #include <algorithm>
 #include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <optional>
+#include <tuple>
 #include <vector>
+#include "cs_flowfield.h"
 #include "cs_serialize.h"
 #include "cs_serialize_fwd.h"
 #include "mesh.h"
@@ -18,12 +23,20 @@
 
 class CS_Terrain
 {
-    static constexpr size_t TEX_SIZ_L2 = 9;
-    static constexpr size_t TEX_SIZ    = (size_t)1 << TEX_SIZ_L2;
+    static constexpr size_t TEX_SIZ_L2  = 9;
+    static constexpr size_t TEX_SIZ     = (size_t)1 << TEX_SIZ_L2;
+    // tiles of cells, to skip the areas without walls in ScanLidar()
+    static constexpr size_t TILE_SIZ_L2 = 3;
+    static constexpr size_t TILES_N     = TEX_SIZ >> TILE_SIZ_L2;
 
     const float mCellSize;
 
     std::vector<float> mHeights;
+    std::vector<float> mTileMaxHeights;
+
+    // flow fields by target cell and wall height, shared by all the sims on this terrain
+    mutable std::mutex mFlowFieldsMutex;
+    mutable std::map<std::tuple<int, int, float>, std::shared_ptr<const CS_FlowField>> mFlowFields;
 
   public:
     std::unique_ptr<ge::Mesh> moMeshW;
@@ -53,6 +66,7 @@ class CS_Terrain
   private:
     void ctor_makeHeightsFromNoise();
     void ctor_makeHeightsFromImage();
+    void ctor_makeTileMaxHeights();
 
   public:
     void AddMeshesToSceneTerr(ge::Scene& scene);
@@ -67,8 +81,18 @@ class CS_Terrain
     float GetHeightFromPos(const glm::vec3& pos) const;
     bool IsPosInside(const glm::vec3& pos) const;
 
-    void ScanRay(const glm::vec3& staPos, const glm::vec3& endPos,
-                 const std::function<bool(const glm::vec3&, float, bool)>& callback) const;
+    // shortest paths to the target around the walls, built on the first request for the target's cell
+    std::shared_ptr<const CS_FlowField> GetFlowField(const glm::vec3& targetPos, float wallHeight) const;
+
+    // callback(pos, height, isOutsideMap) for each cell along the ray, until it returns false
+    // (a template, so that the callback is inlined in the scan loop)
+    template <typename FN> void ScanRay(const glm::vec3& staPos, const glm::vec3& endPos, const FN& callback) const;
+
+    // distance to the first cell above wallHeight or outside the map, for beamsN rays around pos up to range
+    // beam i is at staAngle + 2 pi i / beamsN (angles as atan2(z, x)), pOutDists is lowered where a beam hits
+    // each beam walks every cell it crosses, but the tiles with no walls in one step each
+    void ScanLidar(const glm::vec3& pos, float staAngle, float range, float wallHeight, size_t beamsN,
+                   float* pOutDists) const;
 
     glm::vec2 getUVFromPos(const glm::vec3& pos) const;
     glm::ivec2 getCellFromPos(const glm::vec3& pos) const;
@@ -100,8 +124,8 @@ inline glm::vec3 CS_Terrain::calcPosFromCell(const glm::ivec2& cell) const
     return {x, 0, z};
 }
 
-inline void CS_Terrain::ScanRay(const glm::vec3& staPos, const glm::vec3& endPos,
-                                const std::function<bool(const glm::vec3&, float, bool)>& callback) const
+template <typename FN>
+inline void CS_Terrain::ScanRay(const glm::vec3& staPos, const glm::vec3& endPos, const FN& callback) const
 {
     auto isCellOutsideMap = [](const glm::ivec2& cell) {
         return cell[0] < 0 || cell[0] >= (int)TEX_SIZ || cell[1] < 0 || cell[1] >= (int)TEX_SIZ;
@@ -149,7 +173,7 @@ inline void CS_Terrain::ScanRay(const glm::vec3& staPos, const glm::vec3& endPos
 
         if (isCellOutsideMap(cell))
         {
-            if (!callback(pos, 0, true)) break;
+            if (!callback(pos, 0.f, true)) break;
         }
         else
         {
@@ -0,0 +1,220 @@
+#ifndef CS_THREADPOOL_H
+#define CS_THREADPOOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <exception>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+static inline bool isFutureReady(const std::future<void>& f)
+{
+    return f.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+}
+
+inline size_t CS_GetCoresN()
+{
+    return std::max((size_t)1, (size_t)std::thread::hardware_concurrency());
+}
+
+// number of workers used for the evaluation and the breeding
+inline size_t CS_GetWorkersN()
+{
+    return CS_GetCoresN() + 1;
+}
+
+// true on the threads of the pools below, where the work is already split among the cores
+// (i.e. a sim evaluated by the trainer), so splitting it further would only oversubscribe them
+inline bool& CS_IsInWorkerRef()
+{
+    thread_local bool isInWorker{};
+    return isInWorker;
+}
+
+inline bool CS_IsInWorker()
+{
+    return CS_IsInWorkerRef();
+}
+
+// marks the current thread as a worker, for the scope
+class CS_InWorkerScope
+{
+    const bool mWasInWorker;
+
+  public:
+    CS_InWorkerScope() : mWasInWorker(CS_IsInWorkerRef()) { CS_IsInWorkerRef() = true; }
+    ~CS_InWorkerScope() { CS_IsInWorkerRef() = mWasInWorker; }
+};
+
+class CS_QuickThreadPool
+{
+    const size_t mTheadsN;
+    std::vector<std::future<void>> mFutures;
+
+  public:
+    CS_QuickThreadPool(size_t threadsN) : mTheadsN(threadsN) { mFutures.reserve(threadsN); }
+
+    ~CS_QuickThreadPool() { JoinTheads(); }
+
+    void JoinTheads()
+    {
+        try
+        {
+            for (auto& f : mFutures)
+                if (f.valid()) f.get();
+        } catch (const std::exception& ex)
+        {
+            printf("ERROR: Uncaught Exception ! '%s'\n", ex.what());
+            throw;
+        }
+    }
+
+    void AddThread(std::function<void()> fn)
+    {
+        // flush what's done
+        mFutures.erase(
+            std::remove_if(mFutures.begin(), mFutures.end(), [&](const auto& a) { return isFutureReady(a); }),
+            mFutures.end());
+
+        // force wait if we're full
+        while (mFutures.size() >= mTheadsN)
+        {
+            mFutures[0].get();
+            mFutures.erase(mFutures.begin());
+        }
+
+        mFutures.push_back(std::async(std::launch::async, [fn = std::move(fn)]() {
+            CS_InWorkerScope inWorker;
+            fn();
+        }));
+    }
+};
+
+// run fn(idx) for idx in [0, n), split in contiguous chunks, one per worker
+// the partitioning is static, so the work assigned to an index never depends on timing
+template <typename FN> void CS_ParallelFor(size_t n, size_t threadsN, const FN& fn)
+{
+    const auto chunksN = std::max((size_t)1, std::min(n, threadsN));
+    if (chunksN <= 1)
+    {
+        for (size_t i = 0; i < n; ++i) fn(i);
+        return;
+    }
+
+    const auto chunkSize = (n + chunksN - 1) / chunksN;
+
+    CS_QuickThreadPool thpool(chunksN);
+    CS_InWorkerScope inWorker;
+    // the calling thread takes the first chunk
+    for (size_t sta = chunkSize; sta < n; sta += chunkSize)
+    {
+        const auto end = std::min(n, sta + chunkSize);
+        thpool.AddThread([&fn, sta, end]() {
+            for (size_t i = sta; i < end; ++i) fn(i);
+        });
+    }
+    for (size_t i = 0; i < std::min(n, chunkSize); ++i) fn(i);
+}
+
+// threads that stay up between the calls, for work split many times per second (i.e. each step of a sim)
+// one call at a time, the calling thread takes part
+class CS_WorkerPool
+{
+    std::vector<std::thread> mThreads;
+    std::mutex mMutex;
+    std::condition_variable mStartCV;
+    std::condition_variable mDoneCV;
+    const std::function<void(size_t)>* mpFn{};
+    size_t mChunksN{};
+    std::atomic<size_t> mNextChunk{};
+    size_t mBusyN{};
+    uint64_t mCallIdx{};
+    bool mQuit{};
+    std::exception_ptr mException;
+
+  public:
+    explicit CS_WorkerPool(size_t threadsN)
+    {
+        mThreads.reserve(threadsN);
+        for (size_t i = 0; i < threadsN; ++i) mThreads.emplace_back([this]() { workerLoop(); });
+    }
+
+    ~CS_WorkerPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mQuit = true;
+        }
+        mStartCV.notify_all();
+        for (auto& th : mThreads) th.join();
+    }
+
+    size_t GetThreadsN() const { return mThreads.size(); }
+
+    // run fn(chunkIdx) for chunkIdx in [0, chunksN), and wait for all of them
+    // which thread takes a chunk depends on timing, so the work of a chunk must not depend on it
+    void RunChunks(size_t chunksN, const std::function<void(size_t)>& fn)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mpFn       = &fn;
+            mChunksN   = chunksN;
+            mNextChunk = 0;
+            mBusyN     = mThreads.size();
+            ++mCallIdx;
+        }
+        mStartCV.notify_all();
+
+        {
+            CS_InWorkerScope inWorker;
+            runChunks();
+        }
+
+        std::unique_lock<std::mutex> lock(mMutex);
+        mDoneCV.wait(lock, [this]() { return mBusyN == 0; });
+        mpFn = nullptr;
+        if (mException) std::rethrow_exception(std::exchange(mException, nullptr));
+    }
+
+  private:
+    void runChunks()
+    {
+        try
+        {
+            for (size_t i = mNextChunk++; i < mChunksN; i = mNextChunk++) (*mpFn)(i);
+        } catch (...)
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            if (!mException) mException = std::current_exception();
+        }
+    }
+
+    void workerLoop()
+    {
+        CS_InWorkerScope inWorker;
+        uint64_t doneCallIdx = 0;
+        for (;;)
+        {
+            {
+                std::unique_lock<std::mutex> lock(mMutex);
+                mStartCV.wait(lock, [&]() { return mQuit || mCallIdx != doneCallIdx; });
+                if (mQuit) return;
+                doneCallIdx = mCallIdx;
+            }
+            runChunks();
+
+            std::lock_guard<std::mutex> lock(mMutex);
+            if (--mBusyN == 0) mDoneCV.notify_one();
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,210 @@
+#include <array>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "cs_trace.h"
+
+namespace CS_Trace
+{
+    namespace
+    {
+        struct Event
+        {
+            const char* pName;
+            uint64_t staUS;
+            uint64_t durUS;
+            char ph; // 'X' span, 'i' instant
+        };
+
+        // one producer (the thread that owns it), one consumer (the flush thread)
+        struct Ring
+        {
+            static constexpr uint64_t SIZE = 4096; // power of 2
+
+            std::array<Event, SIZE> events;
+            std::atomic<uint64_t> head{}; // next to write, producer side
+            std::atomic<uint64_t> tail{}; // next to read, consumer side
+            std::atomic<bool> isRetired{};
+            uint32_t tid{};
+
+            bool Push(const Event& e)
+            {
+                const auto h = head.load(std::memory_order_relaxed);
+                if (h - tail.load(std::memory_order_acquire) >= SIZE) return false;
+                events[h & (SIZE - 1)] = e;
+                head.store(h + 1, std::memory_order_release);
+                return true;
+            }
+
+            template <typename FN> void Drain(const FN& fn)
+            {
+                auto t       = tail.load(std::memory_order_relaxed);
+                const auto h = head.load(std::memory_order_acquire);
+                for (; t != h; ++t) fn(events[t & (SIZE - 1)]);
+                tail.store(t, std::memory_order_release);
+            }
+        };
+
+        const auto gT0 = std::chrono::steady_clock::now();
+
+        // rings of the threads, and those of exited threads for reuse (the thread pools are short-lived)
+        std::mutex gMutex;
+        std::vector<std::unique_ptr<Ring>> gRings;
+        std::vector<std::unique_ptr<Ring>> gFreeRings;
+        uint32_t gNextTid{};
+        std::atomic<uint64_t> gDroppedN{};
+
+        // owned by Start()/Stop()
+        std::mutex gStartStopMutex;
+        FILE* gpFile{};
+        bool gIsFirstEvent{};
+        std::thread gFlushThread;
+        std::atomic<bool> gStopFlush{};
+
+        struct ThreadRing
+        {
+            Ring* pRing{};
+
+            ~ThreadRing()
+            {
+                if (pRing) pRing->isRetired.store(true, std::memory_order_release);
+            }
+        };
+        thread_local ThreadRing tThreadRing;
+
+        Ring* getThreadRing()
+        {
+            if (tThreadRing.pRing) return tThreadRing.pRing;
+
+            std::lock_guard<std::mutex> lock(gMutex);
+            std::unique_ptr<Ring> oRing;
+            if (!gFreeRings.empty())
+            {
+                oRing = std::move(gFreeRings.back());
+                gFreeRings.pop_back();
+                oRing->isRetired = false;
+            }
+            else
+            {
+                // the track of a reused ring is shared by the threads that had it, one after the other
+                oRing      = std::make_unique<Ring>();
+                oRing->tid = ++gNextTid;
+            }
+            tThreadRing.pRing = oRing.get();
+            gRings.push_back(std::move(oRing));
+            return tThreadRing.pRing;
+        }
+
+        void writeEvent(const Event& e, uint32_t tid)
+        {
+            fprintf(gpFile, "%s\n", gIsFirstEvent ? "" : ",");
+            gIsFirstEvent = false;
+            if (e.ph == 'X')
+                fprintf(gpFile, R"({"name":"%s","ph":"X","ts":%)" PRIu64 R"(,"dur":%)" PRIu64 R"(,"pid":1,"tid":%u})",
+                        e.pName, e.staUS, e.durUS, tid);
+            else
+                fprintf(gpFile, R"({"name":"%s","ph":"i","s":"p","ts":%)" PRIu64 R"(,"pid":1,"tid":%u})", e.pName,
+                        e.staUS, tid);
+        }
+
+        // write what's in the rings, hand the rings of exited threads back for reuse
+        void drainRings(bool doWrite)
+        {
+            std::lock_guard<std::mutex> lock(gMutex);
+            for (size_t i = 0; i < gRings.size();)
+            {
+                auto& ring = *gRings[i];
+                // the owner sets it after its last push, so a drain after reading it gets everything
+                const auto isRetired = ring.isRetired.load(std::memory_order_acquire);
+                ring.Drain([&](const Event& e) {
+                    if (doWrite) writeEvent(e, ring.tid);
+                });
+                if (isRetired)
+                {
+                    gFreeRings.push_back(std::move(gRings[i]));
+                    gRings.erase(gRings.begin() + (ptrdiff_t)i);
+                }
+                else
+                {
+                    ++i;
+                }
+            }
+            if (doWrite) fflush(gpFile);
+        }
+
+        void flushThreadFn()
+        {
+            while (!gStopFlush.load())
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(50));
+                drainRings(true);
+            }
+            drainRings(true);
+        }
+
+        // stop at exit, if still running
+        struct AtExit
+        {
+            ~AtExit() { Stop(); }
+        } gAtExit;
+    } // namespace
+
+    bool Start(const std::string& fname)
+    {
+        std::lock_guard<std::mutex> lock(gStartStopMutex);
+        if (gpFile) return true;
+
+        gpFile = fopen(fname.c_str(), "w");
+        if (!gpFile) return false;
+
+        // discard what was left from a previous run
+        drainRings(false);
+
+        fprintf(gpFile, "[");
+        gIsFirstEvent = true;
+        gStopFlush    = false;
+        gFlushThread  = std::thread(flushThreadFn);
+        gIsOn         = true;
+        return true;
+    }
+
+    void Stop()
+    {
+        std::lock_guard<std::mutex> lock(gStartStopMutex);
+        if (!gpFile) return;
+
+        gIsOn      = false;
+        gStopFlush = true;
+        gFlushThread.join();
+
+        fprintf(gpFile, "\n]\n");
+        fclose(gpFile);
+        gpFile = nullptr;
+    }
+
+    uint64_t GetDroppedN()
+    {
+        return gDroppedN.load();
+    }
+
+    uint64_t NowUS()
+    {
+        const auto dt = std::chrono::steady_clock::now() - gT0;
+        return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(dt).count();
+    }
+
+    void AddSpan(const char* pName, uint64_t staUS, uint64_t endUS)
+    {
+        if (!getThreadRing()->Push({pName, staUS, endUS - staUS, 'X'})) ++gDroppedN;
+    }
+
+    void AddInstant(const char* pName)
+    {
+        if (!getThreadRing()->Push({pName, NowUS(), 0, 'i'})) ++gDroppedN;
+    }
+
+} // namespace CS_Trace
@@ -0,0 +1,64 @@
+#ifndef CS_TRACE_H
+#define CS_TRACE_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// timeline of what the threads do, written as a Chrome trace (chrome://tracing or ui.perfetto.dev)
+// each thread writes its events into its own lock-free ring, a background thread drains the rings to the file
+// when off, an event costs a relaxed load
+namespace CS_Trace
+{
+    inline std::atomic<bool> gIsOn{false};
+
+    inline bool IsOn()
+    {
+        return gIsOn.load(std::memory_order_relaxed);
+    }
+
+    // starts writing to the file (replacing it), false if it can't be opened
+    bool Start(const std::string& fname);
+    void Stop();
+
+    // events that didn't fit in the rings since the start
+    uint64_t GetDroppedN();
+
+    // microseconds since the start of the process
+    uint64_t NowUS();
+
+    // names must be string literals, only the pointer is kept
+    void AddSpan(const char* pName, uint64_t staUS, uint64_t endUS);
+    void AddInstant(const char* pName);
+
+    class Scope
+    {
+        const char* mpName{};
+        uint64_t mStaUS{};
+
+      public:
+        Scope(const char* pName)
+        {
+            if (!IsOn()) return;
+            mpName = pName;
+            mStaUS = NowUS();
+        }
+
+        ~Scope()
+        {
+            if (mpName && IsOn()) AddSpan(mpName, mStaUS, NowUS());
+        }
+    };
+
+} // namespace CS_Trace
+
+#define CS_TRACE_CAT2(a, b) a##b
+#define CS_TRACE_CAT(a, b) CS_TRACE_CAT2(a, b)
+#define CS_TRACE_SCOPE(name) CS_Trace::Scope CS_TRACE_CAT(_csTraceScope, __LINE__)(name)
+#define CS_TRACE_INSTANT(name)                                                                                         \
+    do                                                                                                                 \
+    {                                                                                                                  \
+        if (CS_Trace::IsOn()) CS_Trace::AddInstant(name);                                                              \
+    } while (0)
+
+#endif
@@ -2,16 +2,29 @@
 #define CS_TRAINBASE_H
 
 #include <functional>
+#include <limits>
 #include <memory>
 #include <sstream>
 #include <vector>
 #include "cs_brainbase.h"
+#include "cs_threadpool.h"
 
 struct CS_ChromoInfo
 {
     double ci_cost{0.0};
     size_t ci_epochIdx{0};
     size_t ci_popIdx{0};
+    size_t ci_fidelity{0};      // evaluation rung reached, costs are only comparable within the same one
+    double ci_horizonFrac{1.0}; // fraction of the sim max time of the curriculum, same as above
+    bool ci_isCostLowBound{};   // the evaluation may have stopped early, the cost is only a lower bound
+
+    // true if a ranks before b
+    static bool IsBetter(const CS_ChromoInfo& a, const CS_ChromoInfo& b)
+    {
+        if (a.ci_horizonFrac != b.ci_horizonFrac) return a.ci_horizonFrac > b.ci_horizonFrac;
+        if (a.ci_fidelity != b.ci_fidelity) return a.ci_fidelity > b.ci_fidelity;
+        return a.ci_cost < b.ci_cost;
+    }
 
     std::string MakeStrID() const
     {
@@ -26,6 +39,10 @@ class CS_TrainBase
   public:
     const size_t mInsN;
     const size_t mOutsN;
+    // threads for the trainer's own work (i.e. breeding), its share of the workers when there are islands
+    size_t mWorkersN{CS_GetWorkersN()};
+    // pre-screen the offspring with a surrogate model of the cost (for the models that have one)
+    bool mUseSurrogate{};
 
     template <typename T> using function   = std::function<T>;
     template <typename T> using vector     = std::vector<T>;
@@ -41,6 +58,25 @@ class CS_TrainBase
     virtual vector<CS_Chromo> OnEpochEnd(size_t epochIdx, const CS_Chromo* pChromos, const CS_ChromoInfo* pInfos,
                                          size_t n)                        = 0;
 
+    // true if a chromosome fully describes its brain (i.e. no references to the trainer's state),
+    // so that equal chromosomes always produce equal brains
+    virtual bool HasSelfContainedChromos() const { return false; }
+
+    // how many of the best chromosomes of an epoch are used to breed the next one
+    // the others only need to be known to be worse (0 if all costs need to be exact)
+    virtual size_t GetSelectionN() const { return 0; }
+
+    // steady-state evolution: rather than by epochs, each chromosome is reported as soon as it's evaluated
+    // and a single replacement is bred right away from the current elite
+    virtual bool SupportsSteadyState() const { return false; }
+
+    virtual void OnChromoEvaluated(const CS_Chromo&, const CS_ChromoInfo&) {}
+
+    virtual CS_Chromo MakeOffspring(size_t) { return {}; }
+
+    // how well the surrogate ranked the last epoch's chromosomes, 1 = perfectly (NaN if not known)
+    virtual double GetSurrogateRankCorr() const { return std::numeric_limits<double>::quiet_NaN(); }
+
     virtual void LockViewBestChromos(
         const std::function<void(const std::vector<CS_Chromo>&, const std::vector<CS_ChromoInfo>&)>& func) = 0;
 };
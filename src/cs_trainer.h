@@ -1,57 +1,117 @@
 #ifndef _CS_TRAINER_
 #define _CS_TRAINER_
 
+#include <algorithm>
 #include <atomic>
+#include <cmath>
 #include <functional>
 #include <future>
+#include <limits>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
 #include <vector>
 #include "cs_brainbase.h"
+#include "cs_fitnesscache.h"
+#include "cs_hash.h"
+#include "cs_mpscqueue.h"
+#include "cs_novelty.h"
+#include "cs_threadpool.h"
+#include "cs_trace.h"
 #include "cs_trainbase.h"
 
-static inline bool isFutureReady(const std::future<void>& f)
+// keeps track of the k-th best cost, to let the evaluations that can't make it stop early
+class CS_KthBestTracker
 {
-    return f.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
-}
+    const size_t mK;
+    std::mutex mMutex;
+    std::priority_queue<double> mBestCosts; // max-heap of the best k costs
+    std::atomic<double> mBound{std::numeric_limits<double>::infinity()};
+
+  public:
+    CS_KthBestTracker(size_t k) : mK(k) {}
+
+    void AddCost(double cost)
+    {
+        if (!mK) return;
+
+        std::lock_guard<std::mutex> lock(mMutex);
+        mBestCosts.push(cost);
+        if (mBestCosts.size() > mK) mBestCosts.pop();
+        if (mBestCosts.size() == mK) mBound = mBestCosts.top();
+    }
 
-class CS_QuickThreadPool
+    // infinity until k costs are known
+    const std::atomic<double>& GetBound() const { return mBound; }
+};
+
+// the bound passed to an evaluation: the k-th best cost, or what's left of it for a part of an evaluation
+class CS_CostBound
 {
-    const size_t mTheadsN;
-    std::vector<std::future<void>> mFutures;
+    const std::atomic<double>& mBound;
+    const double mScale{1.0};
+    const std::atomic<double>* mpDoneCost{};
 
   public:
-    CS_QuickThreadPool(size_t threadsN) : mTheadsN(threadsN) { mFutures.reserve(threadsN); }
+    explicit CS_CostBound(const std::atomic<double>& bound) : mBound(bound) {}
+
+    // for one of partsN parts of an evaluation averaged over the parts, given the sum of the parts already done
+    CS_CostBound(const std::atomic<double>& bound, size_t partsN, const std::atomic<double>& doneCost)
+        : mBound(bound), mScale((double)partsN), mpDoneCost(&doneCost)
+    {
+    }
 
-    ~CS_QuickThreadPool() { JoinTheads(); }
+    // the evaluation can stop as soon as it knows that its cost will be above this
+    double Get() const { return mBound * mScale - (mpDoneCost ? mpDoneCost->load() : 0.0); }
+};
 
-    void JoinTheads()
+static inline void atomicAddDouble(std::atomic<double>& dst, double val)
+{
+    auto cur = dst.load();
+    while (!dst.compare_exchange_weak(cur, cur + val)) {}
+}
+
+// horizon curriculum: the fraction of the sim max time to evaluate on, grown when the best cost plateaus
+class CS_HorizonCurriculum
+{
+    const double mGrowFactor;
+    const size_t mPlateauEpochsN;
+    const double mPlateauTol;
+
+    double mFrac;
+    double mBestCost{std::numeric_limits<double>::infinity()};
+    size_t mStaleEpochsN{};
+
+  public:
+    CS_HorizonCurriculum(double startFrac, double growFactor, size_t plateauEpochsN, double plateauTol)
+        : mGrowFactor(growFactor), mPlateauEpochsN(plateauEpochsN), mPlateauTol(plateauTol),
+          mFrac(std::clamp(startFrac, 0.0, 1.0))
     {
-        try
-        {
-            for (auto& f : mFutures)
-                if (f.valid()) f.get();
-        } catch (const std::exception& ex)
-        {
-            printf("ERROR: Uncaught Exception ! '%s'\n", ex.what());
-            throw;
-        }
     }
 
-    void AddThread(std::function<void()> fn)
+    double GetFrac() const { return mFrac; }
+
+    // with the best cost of the epoch, true if the horizon has grown
+    bool OnEpochEnd(double bestCost)
     {
-        // flush what's done
-        mFutures.erase(
-            std::remove_if(mFutures.begin(), mFutures.end(), [&](const auto& a) { return isFutureReady(a); }),
-            mFutures.end());
+        if (mFrac >= 1.0) return false;
 
-        // force wait if we're full
-        while (mFutures.size() >= mTheadsN)
+        // improved by more than the tolerance (relative) ?
+        if (bestCost < mBestCost - mPlateauTol * std::abs(mBestCost) || std::isinf(mBestCost))
         {
-            mFutures[0].get();
-            mFutures.erase(mFutures.begin());
+            mBestCost     = bestCost;
+            mStaleEpochsN = 0;
+            return false;
         }
+        if (++mStaleEpochsN < mPlateauEpochsN) return false;
 
-        mFutures.push_back(std::async(std::launch::async, fn));
+        // costs of a different horizon are not comparable, start over
+        mFrac         = std::min(1.0, mFrac * mGrowFactor);
+        mBestCost     = std::numeric_limits<double>::infinity();
+        mStaleEpochsN = 0;
+        return true;
     }
 };
 
@@ -63,82 +123,649 @@ class CS_Trainer
 
   public:
     using CreateBrainFnT = function<unique_ptr<CS_BrainBase>(const CS_Chromo&, size_t, size_t)>;
-    using EvalBrainT     = function<double(const CS_BrainBase&, std::atomic<bool>&)>;
+    // brain, shutdown request, cost bound (the evaluation can stop and return any cost above the bound,
+    // as soon as it knows that the final cost will be above it), behavior descriptor output (may be null)
+    using EvalBrainT =
+        function<double(const CS_BrainBase&, std::atomic<bool>&, const CS_CostBound&, CS_BehaviorDesc*)>;
     using OnEpochEndFnT  = function<vector<CS_Chromo>(size_t, const CS_Chromo*, const double*, size_t)>;
+    // island index
+    using CreateTrainFnT = function<unique_ptr<CS_TrainBase>(size_t)>;
+
+    enum class MigrationTopology
+    {
+        RING,  // to the next island
+        FULLY, // to all the other islands
+    };
 
   private:
+    // a sub-population, evolved independently, with a share of the workers
+    struct Island
+    {
+        unique_ptr<CS_TrainBase> oTrain;
+        size_t workersN{};
+        std::atomic<size_t> curEpochN{};
+        std::atomic<double> horizonFrac{1.0};
+        unique_ptr<CS_NoveltyArchive> oArchive;
+        // migrants from the other islands, to be added to the next epoch
+        std::mutex inboxMutex;
+        vector<CS_Chromo> inbox;
+    };
+
     std::future<void> mFuture;
     std::atomic<bool> mShutdownReq{};
-    size_t mCurEpochN{};
-    unique_ptr<CS_TrainBase> moTrain;
+    std::atomic<size_t> mEvalsDoneN{};
+    bool mIsSteadyState{};
+    vector<unique_ptr<Island>> moIslands;
+    unique_ptr<CS_FitnessCache> moCache;
 
   public:
+    // a level of fidelity of the successive halving evaluation
+    struct EvalRung
+    {
+        double timeFrac{1.0}; // fraction of the simulation max time
+        size_t terrainsN{0};  // number of terrains to evaluate on (0 = all)
+        double keepFrac{1.0}; // fraction of the evaluated that advance to the next rung
+
+        // identifies the rung in the fitness cache, out of allTerrainsN terrains
+        // the full time on all the terrains is the plain full evaluation (0), whatever the rung
+        uint64_t MakeCacheVariant(size_t allTerrainsN) const
+        {
+            if (timeFrac >= 1.0 && (!terrainsN || terrainsN >= allTerrainsN)) return 0;
+
+            const double vals[2] = {timeFrac, (double)(terrainsN >= allTerrainsN ? 0 : terrainsN)};
+            return CS_HashBytes64(vals, sizeof(vals), 1);
+        }
+    };
+    // brain, rung, terrain index, shutdown request, cost bound, behavior descriptor output
+    using EvalBrainTerrT = function<double(const CS_BrainBase&, const EvalRung&, size_t, std::atomic<bool>&,
+                                           const CS_CostBound&, CS_BehaviorDesc*)>;
+
     struct Params
     {
         size_t maxEpochsN{};
         EvalBrainT evalBrainFn;
+        // alternative to evalBrainFn, evaluation of a brain on a single terrain, so that each terrain of each brain
+        // is a separate task (the cost of a brain is the mean over the terrains)
+        size_t terrainsN{};
+        EvalBrainTerrT evalBrainTerrFn;
+        // evaluation in rungs of increasing fidelity (needs evalBrainTerrFn)
+        // only the costs of the last rung reached are comparable
+        vector<EvalRung> evalRungs;
+        // skip the evaluation of chromosomes already evaluated on the same scenario
+        bool useFitnessCache{true};
+        // pre-screen the offspring with a surrogate model of the cost, for the models that have one
+        bool useSurrogate{};
+        // hash of everything other than the brain that affects the cost (terrains, sim params, sim code)
+        uint64_t scenarioFingerprint{};
+        // no epochs, a replacement is bred and dispatched as soon as an evaluation is done, for up to
+        // maxEpochsN * population size evaluations (full fidelity only, rungs are ignored, single island)
+        bool useSteadyState{};
+        // island model, each island has its own population and trainer (islandsN > 1 needs a CreateTrainFnT)
+        // every migrationInterval epochs, the best migrantsN of an island are copied to its neighbours
+        // (only with self-contained chromosomes)
+        size_t islandsN{1};
+        size_t migrationInterval{10};
+        size_t migrantsN{2};
+        MigrationTopology migrationTopology{MigrationTopology::RING};
+        // novelty search: chromosomes are ranked by cost - noveltyWeight * novelty, where the novelty is the
+        // mean distance of the behavior descriptor to the k nearest seen so far (not in steady-state mode)
+        // the costs shown in the best lists include it, the rungs rank by it too, and early stopping is disabled
+        double noveltyWeight{};
+        size_t noveltyK{15};
+        // horizon curriculum: evaluations start at horizonStartFrac of the sim max time (1 = no curriculum),
+        // and the horizon is multiplied by horizonGrowFactor (up to 1) each time the best cost of an island
+        // hasn't improved by more than horizonPlateauTol (relative) in horizonPlateauEpochsN epochs
+        // it scales the time of the rungs, so it needs evalBrainTerrFn (not in steady-state mode)
+        double horizonStartFrac{1.0};
+        double horizonGrowFactor{2.0};
+        size_t horizonPlateauEpochsN{10};
+        double horizonPlateauTol{0.01};
     };
 
   public:
-    CS_Trainer(const Params& par, unique_ptr<CS_TrainBase>&& oTrain) : moTrain(std::move(oTrain))
+    CS_Trainer(const Params& par, unique_ptr<CS_TrainBase>&& oTrain)
     {
-        mFuture = std::async(std::launch::async, [this, par = par]() { ctor_execution(par); });
+        moIslands.push_back(std::make_unique<Island>());
+        moIslands.back()->oTrain = std::move(oTrain);
+        ctor_start(par);
     }
 
+    CS_Trainer(const Params& par, const CreateTrainFnT& createTrainFn)
+    {
+        const auto islandsN = par.useSteadyState ? 1 : std::max((size_t)1, par.islandsN);
+        for (size_t i = 0; i < islandsN; ++i)
+        {
+            moIslands.push_back(std::make_unique<Island>());
+            moIslands.back()->oTrain = createTrainFn(i);
+        }
+        ctor_start(par);
+    }
+
+    // the best of all the islands
     void LockViewBestChromos(
         const std::function<void(const std::vector<CS_Chromo>&, const std::vector<CS_ChromoInfo>&)>& func)
     {
-        moTrain->LockViewBestChromos(func);
+        if (moIslands.size() == 1)
+        {
+            moIslands[0]->oTrain->LockViewBestChromos(func);
+            return;
+        }
+
+        vector<CS_Chromo> chromos;
+        vector<CS_ChromoInfo> infos;
+        size_t maxN = 0;
+        for (const auto& oIsl : moIslands)
+            oIsl->oTrain->LockViewBestChromos([&](const auto& islChromos, const auto& islInfos) {
+                chromos.insert(chromos.end(), islChromos.begin(), islChromos.end());
+                infos.insert(infos.end(), islInfos.begin(), islInfos.end());
+                maxN = std::max(maxN, islInfos.size());
+            });
+
+        // merge, keeping as many as a single island would
+        vector<size_t> order(infos.size());
+        for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+        std::stable_sort(order.begin(), order.end(),
+                         [&](size_t a, size_t b) { return CS_ChromoInfo::IsBetter(infos[a], infos[b]); });
+        order.resize(std::min(order.size(), maxN));
+
+        vector<CS_Chromo> bestChromos;
+        vector<CS_ChromoInfo> bestInfos;
+        for (const auto idx : order)
+        {
+            bestChromos.push_back(std::move(chromos[idx]));
+            bestInfos.push_back(infos[idx]);
+        }
+        func(bestChromos, bestInfos);
     }
 
   private:
-    void ctor_execution(const Params& par)
+    void ctor_start(const Params& par)
     {
+        const auto& train = *moIslands[0]->oTrain;
+
+        // caching is only meaningful when the chromosome is the whole brain
+        if (par.useFitnessCache && train.HasSelfContainedChromos())
+            moCache = std::make_unique<CS_FitnessCache>(par.scenarioFingerprint);
+
+        mIsSteadyState = par.useSteadyState && train.SupportsSteadyState();
+
+        // split the workers among the islands
+        const auto islandsN = moIslands.size();
+        for (auto& oIsl : moIslands)
+        {
+            oIsl->workersN              = std::max((size_t)1, CS_GetWorkersN() / islandsN);
+            oIsl->oTrain->mWorkersN     = oIsl->workersN;
+            oIsl->oTrain->mUseSurrogate = par.useSurrogate;
+            if (par.noveltyWeight) oIsl->oArchive = std::make_unique<CS_NoveltyArchive>(par.noveltyK);
+        }
+
+        mFuture = std::async(std::launch::async, [this, par = par]() {
+            if (mIsSteadyState) ctor_executionSteady(par);
+            else
+                CS_ParallelFor(moIslands.size(), moIslands.size(), [&](size_t i) { ctor_execution(par, i); });
+        });
+    }
+
+    void ctor_execution(const Params& par, size_t islIdx)
+    {
+        auto& isl         = *moIslands[islIdx];
+        const auto doMigr = moIslands.size() > 1 && par.migrantsN && par.migrationInterval &&
+                            isl.oTrain->HasSelfContainedChromos();
+
         // get the starting chromosomes (i.e. random or from file)
-        auto chromos = moTrain->MakeStartChromos();
+        auto chromos = isl.oTrain->MakeStartChromos();
         size_t popN  = chromos.size();
 
+        // evalBrainFn always runs the full time, there's no horizon to grow
+        const auto useTerrFn = par.evalBrainTerrFn && par.terrainsN;
+        CS_HorizonCurriculum curriculum(useTerrFn ? par.horizonStartFrac : 1.0, par.horizonGrowFactor,
+                                        par.horizonPlateauEpochsN, par.horizonPlateauTol);
+
         for (size_t eidx = 0; eidx < par.maxEpochsN && !mShutdownReq; ++eidx)
         {
-            mCurEpochN = eidx;
+            CS_TRACE_SCOPE("Epoch");
+
+            isl.curEpochN   = eidx;
+            isl.horizonFrac = curriculum.GetFrac();
 
             // costs are the results of the execution
-            std::vector<std::atomic<double>> costs(popN);
-            {
-                // create a thread for each available core
-                CS_QuickThreadPool thpool(std::thread::hardware_concurrency() + 1);
+            vector<CS_ChromoInfo> infos;
+            infos.resize(popN);
+            vector<CS_BehaviorDesc> descs(popN);
+            evalEpoch(par, isl, chromos, infos, descs);
+            CS_TRACE_INSTANT("Epoch barrier");
 
-                // for each member of the population...
-                for (size_t pidx = 0; pidx < popN && !mShutdownReq; ++pidx)
-                {
-                    thpool.AddThread([this, &chromo = chromos[pidx], &cost = costs[pidx], &par]() {
-                        // create and evaluate the brain with the given chromosome
-                        cost = par.evalBrainFn(*moTrain->CreateBrain(chromo), mShutdownReq);
-                    });
-                }
+            // the best cost at the highest fidelity reached, before novelty
+            {
+                double bestCost = std::numeric_limits<double>::infinity();
+                size_t maxFid   = 0;
+                for (const auto& ci : infos) maxFid = std::max(maxFid, ci.ci_fidelity);
+                for (const auto& ci : infos)
+                    if (ci.ci_fidelity == maxFid) bestCost = std::min(bestCost, ci.ci_cost);
+                curriculum.OnEpochEnd(bestCost);
             }
 
+            if (isl.oArchive) applyNovelty(par, isl, infos, descs);
+
             // generate the new chromosomes
-            vector<CS_ChromoInfo> infos;
-            infos.resize(popN);
             for (size_t pidx = 0; pidx < popN; ++pidx)
             {
                 auto& ci       = infos[pidx];
-                ci.ci_cost     = costs[pidx];
                 ci.ci_epochIdx = eidx;
                 ci.ci_popIdx   = pidx;
             }
 
-            chromos = moTrain->OnEpochEnd(eidx, chromos.data(), infos.data(), popN);
+            if (doMigr && !((eidx + 1) % par.migrationInterval)) sendMigrants(par, islIdx, chromos, infos);
+
+            {
+                CS_TRACE_SCOPE("OnEpochEnd");
+                chromos = isl.oTrain->OnEpochEnd(eidx, chromos.data(), infos.data(), popN);
+            }
+
+            if (doMigr) receiveMigrants(isl, chromos);
+
+            popN = chromos.size();
+        }
+    }
+
+    // the weighted novelty of each behavior, against the archive and the others of the list
+    static vector<double> calcNoveltyBonuses(const Params& par, Island& isl, const vector<CS_BehaviorDesc>& descs)
+    {
+        vector<double> bonuses(descs.size());
+        CS_ParallelFor(descs.size(), isl.workersN, [&](size_t i) {
+            bonuses[i] = par.noveltyWeight * isl.oArchive->CalcNovelty(descs[i], descs, i);
+        });
+        return bonuses;
+    }
+
+    // rank by cost and novelty, then remember the behaviors
+    static void applyNovelty(const Params& par, Island& isl, vector<CS_ChromoInfo>& infos,
+                             const vector<CS_BehaviorDesc>& descs)
+    {
+        const auto bonuses = calcNoveltyBonuses(par, isl, descs);
+        for (size_t i = 0; i < infos.size(); ++i)
+        {
+            infos[i].ci_cost -= bonuses[i];
+            isl.oArchive->AddDesc(descs[i]);
+        }
+    }
+
+    // copy the best of the island to the inbox of its neighbours
+    void sendMigrants(const Params& par, size_t islIdx, const vector<CS_Chromo>& chromos,
+                      const vector<CS_ChromoInfo>& infos)
+    {
+        vector<size_t> order(infos.size());
+        for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+        const auto migrN = std::min(par.migrantsN, order.size());
+        std::partial_sort(order.begin(), order.begin() + (ptrdiff_t)migrN, order.end(),
+                          [&](size_t a, size_t b) { return CS_ChromoInfo::IsBetter(infos[a], infos[b]); });
+
+        const auto islandsN = moIslands.size();
+        for (size_t i = 1; i < islandsN; ++i)
+        {
+            auto& dst = *moIslands[(islIdx + i) % islandsN];
+            {
+                std::lock_guard<std::mutex> lock(dst.inboxMutex);
+                for (size_t j = 0; j < migrN; ++j) dst.inbox.push_back(chromos[order[j]]);
+            }
+            if (par.migrationTopology == MigrationTopology::RING) break;
+        }
+    }
+
+    // the migrants take the place of the last of the new chromosomes
+    static void receiveMigrants(Island& isl, vector<CS_Chromo>& chromos)
+    {
+        vector<CS_Chromo> migrants;
+        {
+            std::lock_guard<std::mutex> lock(isl.inboxMutex);
+            migrants.swap(isl.inbox);
+        }
+        const auto n = std::min(migrants.size(), chromos.size());
+        for (size_t i = 0; i < n; ++i) chromos[chromos.size() - 1 - i] = std::move(migrants[i]);
+    }
+
+    // result of an evaluation, from the workers to the trainer
+    struct EvalResult
+    {
+        CS_Chromo chromo;
+        size_t evalIdx{};
+        double cost{};
+    };
+
+    void ctor_executionSteady(const Params& par)
+    {
+        auto& isl   = *moIslands[0];
+        auto& train = *isl.oTrain;
+
+        // the starting chromosomes are the first to evaluate, then come the offspring
+        auto startChromos    = train.MakeStartChromos();
+        const auto popN      = std::max((size_t)1, startChromos.size());
+        const auto maxEvalsN = par.maxEpochsN * popN;
+        const auto workersN  = CS_GetWorkersN();
+
+        CS_MPSCQueue<EvalResult> results;
+        // anything worse than the selection is discarded, so evaluations can stop once they can't make it
+        CS_KthBestTracker bestTracker(train.GetSelectionN());
+        // extra room for the tasks that have posted their result but haven't returned yet
+        CS_QuickThreadPool thpool(workersN * 2 + 1);
+
+        size_t sentN  = 0;
+        auto dispatch = [&]() {
+            const auto evalIdx = sentN++;
+            auto chromo        = evalIdx < startChromos.size() ? std::move(startChromos[evalIdx])
+                                                               : train.MakeOffspring(evalIdx - startChromos.size());
+            // already evaluated ?
+            double cost{};
+            if (moCache && moCache->FindCost(moCache->MakeKey(chromo), cost))
+            {
+                results.Push({std::move(chromo), evalIdx, cost});
+                return;
+            }
+
+            thpool.AddThread([&, chromo = std::move(chromo), evalIdx]() mutable {
+                CS_TRACE_SCOPE("Eval");
+                const auto cost = evalFullFidelity(par, *train.CreateBrain(chromo), bestTracker.GetBound());
+                bestTracker.AddCost(cost);
+                results.Push({std::move(chromo), evalIdx, cost});
+            });
+        };
 
-            popN    = chromos.size();
+        // fill the workers
+        while (sentN < std::min(workersN, maxEvalsN)) dispatch();
+
+        for (size_t doneN = 0; doneN < maxEvalsN && !mShutdownReq;)
+        {
+            EvalResult res;
+            if (!results.TryPop(res))
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                continue;
+            }
+
+            // keep the workers busy first
+            if (sentN < maxEvalsN) dispatch();
+
+            // costs above the bound may come from an early stop, and are only lower bounds
+            if (moCache && !mShutdownReq && res.cost <= bestTracker.GetBound())
+                moCache->StoreCost(moCache->MakeKey(res.chromo), res.cost);
+
+            CS_ChromoInfo info;
+            info.ci_cost           = res.cost;
+            info.ci_epochIdx       = res.evalIdx / popN;
+            info.ci_popIdx         = res.evalIdx % popN;
+            info.ci_isCostLowBound = res.cost > bestTracker.GetBound();
+            train.OnChromoEvaluated(res.chromo, info);
+
+            mEvalsDoneN   = ++doneN;
+            isl.curEpochN = doneN / popN;
         }
     }
 
+    // evaluation at full fidelity, with whatever function is available (no behavior descriptor)
+    double evalFullFidelity(const Params& par, const CS_BrainBase& brain, const std::atomic<double>& bound)
+    {
+        if (par.evalBrainFn) return par.evalBrainFn(brain, mShutdownReq, CS_CostBound(bound), nullptr);
+
+        // one terrain after the other
+        std::atomic<double> doneCost{0.0};
+        const auto terrN = std::max((size_t)1, par.terrainsN);
+        for (size_t tidx = 0; tidx < terrN && !mShutdownReq; ++tidx)
+        {
+            atomicAddDouble(doneCost, par.evalBrainTerrFn(brain, EvalRung(), tidx, mShutdownReq,
+                                                          CS_CostBound(bound, terrN, doneCost), nullptr));
+            if (doneCost / (double)terrN > bound) break;
+        }
+        return doneCost / (double)terrN;
+    }
+
+    // evaluate the population, filling the cost, fidelity and behavior of each chromosome
+    void evalEpoch(const Params& par, Island& isl, const vector<CS_Chromo>& chromos, vector<CS_ChromoInfo>& infos,
+                   vector<CS_BehaviorDesc>& descs)
+    {
+        const auto popN    = chromos.size();
+        const auto selN    = isl.oTrain->GetSelectionN();
+        // with novelty, a high cost doesn't mean it won't be selected
+        const auto noBound = par.noveltyWeight != 0;
+
+        vector<size_t> idxs(popN);
+        for (size_t pidx = 0; pidx < popN; ++pidx) idxs[pidx] = pidx;
+
+        vector<std::atomic<double>> costs(popN);
+        vector<char> lowBounds(popN, 0);
+
+        const auto useTerrFn = par.evalBrainTerrFn && par.terrainsN;
+
+        // the rungs are scaled by the horizon, and so are their cached costs
+        // (always 1 with evalBrainFn, which runs the full time, see ctor_execution)
+        const auto horFrac   = useTerrFn ? isl.horizonFrac.load() : 1.0;
+        auto applyHorizon    = [horFrac](EvalRung rung) {
+            rung.timeFrac *= horFrac;
+            return rung;
+        };
+        for (auto& ci : infos) ci.ci_horizonFrac = horFrac;
+
+        // single evaluation at full fidelity
+        if (par.evalRungs.empty() || !useTerrFn)
+        {
+            if (useTerrFn)
+            {
+                const auto rung    = applyHorizon(EvalRung());
+                const auto variant = rung.MakeCacheVariant(par.terrainsN);
+                evalChromos(isl, chromos, idxs, noBound ? 0 : selN, variant, par.terrainsN, costs, lowBounds, descs,
+                            [&](const CS_BrainBase& brain, size_t tidx, const CS_CostBound& costBound,
+                                CS_BehaviorDesc* pDesc) {
+                    return par.evalBrainTerrFn(brain, rung, tidx, mShutdownReq, costBound, pDesc);
+                });
+            }
+            else
+            {
+                evalChromos(isl, chromos, idxs, noBound ? 0 : selN, 0, 1, costs, lowBounds, descs,
+                            [&](const CS_BrainBase& brain, size_t, const CS_CostBound& costBound,
+                                CS_BehaviorDesc* pDesc) {
+                    return par.evalBrainFn(brain, mShutdownReq, costBound, pDesc);
+                });
+            }
+            for (size_t pidx = 0; pidx < popN; ++pidx)
+            {
+                infos[pidx].ci_cost           = costs[pidx];
+                infos[pidx].ci_isCostLowBound = lowBounds[pidx];
+            }
+            return;
+        }
+
+        // successive halving: each rung evaluates the best of the previous one at a higher fidelity
+        for (size_t ridx = 0; ridx < par.evalRungs.size() && !mShutdownReq; ++ridx)
+        {
+            const auto rung   = applyHorizon(par.evalRungs[ridx]);
+            const auto isLast = (ridx + 1) == par.evalRungs.size();
+            // how many advance to the next rung (never less than what's needed for the selection)
+            const auto fracN  = (size_t)std::ceil(rung.keepFrac * (double)idxs.size());
+            const auto keepN  = std::min(idxs.size(), std::max({(size_t)1, selN, fracN}));
+            const auto boundK = noBound ? 0 : (isLast ? selN : keepN);
+
+            const auto terrN   = rung.terrainsN ? std::min(rung.terrainsN, par.terrainsN) : par.terrainsN;
+            const auto variant = rung.MakeCacheVariant(par.terrainsN);
+            evalChromos(isl, chromos, idxs, boundK, variant, terrN, costs, lowBounds, descs,
+                        [&](const CS_BrainBase& brain, size_t tidx, const CS_CostBound& costBound,
+                            CS_BehaviorDesc* pDesc) {
+                return par.evalBrainTerrFn(brain, rung, tidx, mShutdownReq, costBound, pDesc);
+            });
+
+            for (const auto pidx : idxs)
+            {
+                infos[pidx].ci_cost           = costs[pidx];
+                infos[pidx].ci_fidelity       = ridx;
+                infos[pidx].ci_isCostLowBound = lowBounds[pidx];
+            }
+            if (isLast) break;
+
+            // only the best advance, ranked as in the selection (i.e. with the novelty, if any)
+            vector<double> rankCosts(popN);
+            for (const auto pidx : idxs) rankCosts[pidx] = costs[pidx];
+            if (isl.oArchive)
+            {
+                vector<CS_BehaviorDesc> rungDescs;
+                for (const auto pidx : idxs) rungDescs.push_back(descs[pidx]);
+                const auto bonuses = calcNoveltyBonuses(par, isl, rungDescs);
+                for (size_t i = 0; i < idxs.size(); ++i) rankCosts[idxs[i]] -= bonuses[i];
+            }
+            std::stable_sort(idxs.begin(), idxs.end(), [&](size_t a, size_t b) { return rankCosts[a] < rankCosts[b]; });
+            idxs.resize(keepN);
+        }
+    }
+
+    // evaluate the chromosomes at the given indices, each on terrN terrains
+    // evalFn(brain, terrain index, bound, desc) is called for each terrain of each chromosome in a separate task,
+    // and the cost (and behavior) of the chromosome is the mean of the terrains
+    // lowBounds is set for the costs that may come from an early stop
+    template <typename EVAL_FN>
+    void evalChromos(Island& isl, const vector<CS_Chromo>& chromos, const vector<size_t>& idxs, size_t boundK,
+                     uint64_t cacheVariant, size_t terrN, vector<std::atomic<double>>& costs,
+                     vector<char>& lowBounds, vector<CS_BehaviorDesc>& descs, const EVAL_FN& evalFn)
+    {
+        const auto popN = chromos.size();
+
+        // for each chromosome, the index of the one to take the cost from (itself if it needs evaluation)
+        vector<size_t> srcIdx(popN);
+        vector<CS_FitnessCache::Key> keys(moCache ? popN : 0);
+        vector<char> isCached(popN, 0);
+
+        // the k-th best cost so far, as the bound for the evaluations
+        CS_KthBestTracker bestTracker(boundK);
+        {
+            std::map<CS_FitnessCache::Key, size_t> firstIdx;
+            for (const auto pidx : idxs)
+            {
+                srcIdx[pidx] = pidx;
+                if (!moCache) continue;
+
+                keys[pidx] = moCache->MakeKey(chromos[pidx], cacheVariant);
+                // already evaluated in a previous epoch ?
+                double cost{};
+                if (moCache->FindCost(keys[pidx], cost, &descs[pidx]))
+                {
+                    costs[pidx]    = cost;
+                    isCached[pidx] = 1;
+                    bestTracker.AddCost(cost);
+                }
+                // a twin in this same population ?
+                else if (auto [it, isNew] = firstIdx.emplace(keys[pidx], pidx); !isNew) srcIdx[pidx] = it->second;
+            }
+        }
+
+        // sum of the costs of the terrains done so far, and number of terrains left, for each chromosome
+        vector<std::atomic<double>> doneCosts(popN);
+        vector<std::atomic<size_t>> leftTerrsN(popN);
+        vector<CS_BehaviorDesc> terrDescs(popN * terrN);
+        // the brain of each chromosome, created by the first of its tasks to run, released by the last
+        vector<std::unique_ptr<const CS_BrainBase>> brains(popN);
+        vector<std::once_flag> brainOnces(popN);
+        {
+            // create a thread for each core available to the island
+            CS_QuickThreadPool thpool(isl.workersN);
+
+            // for each member of the population...
+            for (const auto pidx : idxs)
+            {
+                if (mShutdownReq) break;
+                if (isCached[pidx] || srcIdx[pidx] != pidx) continue;
+
+                doneCosts[pidx]  = 0.0;
+                leftTerrsN[pidx] = terrN;
+
+                for (size_t tidx = 0; tidx < terrN && !mShutdownReq; ++tidx)
+                {
+                    thpool.AddThread([&, pidx, tidx]() {
+                        CS_TRACE_SCOPE("Eval");
+                        // create the brain with the given chromosome, shared by the tasks of all the terrains
+                        std::call_once(brainOnces[pidx],
+                                       [&]() { brains[pidx] = isl.oTrain->CreateBrain(chromos[pidx]); });
+                        // evaluate on the terrain
+                        const auto& bound = bestTracker.GetBound();
+                        const auto cost   = evalFn(*brains[pidx], tidx,
+                                                   terrN == 1 ? CS_CostBound(bound)
+                                                              : CS_CostBound(bound, terrN, doneCosts[pidx]),
+                                                   &terrDescs[pidx * terrN + tidx]);
+                        atomicAddDouble(doneCosts[pidx], cost);
+
+                        // the last terrain to finish sets the final cost and behavior
+                        if (--leftTerrsN[pidx] == 0)
+                        {
+                            costs[pidx] = doneCosts[pidx] / (double)terrN;
+                            bestTracker.AddCost(costs[pidx]);
+                            brains[pidx].reset();
+
+                            CS_BehaviorDesc desc;
+                            for (size_t i = 0; i < terrN; ++i)
+                            {
+                                desc.x += terrDescs[pidx * terrN + i].x / (double)terrN;
+                                desc.z += terrDescs[pidx * terrN + i].z / (double)terrN;
+                            }
+                            descs[pidx] = desc;
+                        }
+                    });
+                }
+            }
+        }
+
+        // copy the costs to the twins
+        for (const auto pidx : idxs)
+            if (!isCached[pidx] && srcIdx[pidx] != pidx)
+            {
+                costs[pidx] = costs[srcIdx[pidx]].load();
+                descs[pidx] = descs[srcIdx[pidx]];
+            }
+
+        // store the new results, unless they were interrupted
+        // costs above the final bound may come from an early stop, and are only lower bounds
+        const auto finalBound = bestTracker.GetBound().load();
+        for (const auto pidx : idxs) lowBounds[pidx] = !isCached[pidx] && costs[pidx] > finalBound;
+        if (moCache && !mShutdownReq)
+            for (const auto pidx : idxs)
+                if (!isCached[pidx] && srcIdx[pidx] == pidx && costs[pidx] <= finalBound)
+                    moCache->StoreCost(keys[pidx], costs[pidx], descs[pidx]);
+    }
+
   public:
     auto& GetTrainerFuture() { return mFuture; }
 
-    size_t GetCurEpochN() const { return mCurEpochN; }
+    // the slowest island's
+    size_t GetCurEpochN() const
+    {
+        size_t epochN = std::numeric_limits<size_t>::max();
+        for (const auto& oIsl : moIslands) epochN = std::min(epochN, oIsl->curEpochN.load());
+        return epochN;
+    }
+
+    bool IsSteadyState() const { return mIsSteadyState; }
+
+    // the shortest of the islands'
+    double GetCurHorizonFrac() const
+    {
+        double frac = 1.0;
+        for (const auto& oIsl : moIslands) frac = std::min(frac, oIsl->horizonFrac.load());
+        return frac;
+    }
+
+    size_t GetEvalsDoneN() const { return mEvalsDoneN; }
+
+    // the mean of the islands' (NaN if none is known)
+    double GetSurrogateRankCorr() const
+    {
+        double sum = 0;
+        size_t n   = 0;
+        for (const auto& oIsl : moIslands)
+            if (const auto corr = oIsl->oTrain->GetSurrogateRankCorr(); !std::isnan(corr))
+            {
+                sum += corr;
+                ++n;
+            }
+        return n ? sum / (double)n : std::numeric_limits<double>::quiet_NaN();
+    }
+
+    size_t GetCacheHitsN() const { return moCache ? moCache->GetHitsN() : 0; }
+
+    size_t GetCacheMissesN() const { return moCache ? moCache->GetMissesN() : 0; }
 
     void ReqShutdown() { mShutdownReq = true; }
 };
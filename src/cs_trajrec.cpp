@@ -0,0 +1,262 @@
+#include <algorithm>
+#include <cmath>
+#include "cs_trajrec.h"
+
+// file: FileHeader, then the chunks
+// chunk: ChunkHeader, times (double, stepsN), unit offsets (uint32, unitsN + 1), data
+// data: for each unit, for each step, FIELDS_N zigzag varints of the deltas
+struct FileHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t unitsN;
+    uint32_t fieldsN;
+};
+
+struct ChunkHeader
+{
+    uint32_t magic;
+    uint32_t firstStep;
+    uint32_t stepsN;
+    uint32_t dataSize;
+};
+
+static inline void appendVarint(std::vector<uint8_t>& buff, int32_t val)
+{
+    // zigzag, so that small negatives are small too
+    auto u = ((uint32_t)val << 1) ^ (uint32_t)(val >> 31);
+    while (u >= 0x80)
+    {
+        buff.push_back((uint8_t)(u | 0x80));
+        u >>= 7;
+    }
+    buff.push_back((uint8_t)u);
+}
+
+static inline int32_t readVarint(const uint8_t*& p, const uint8_t* pEnd)
+{
+    uint32_t u     = 0;
+    uint32_t shift = 0;
+    while (p < pEnd)
+    {
+        const auto b = *p++;
+        u |= (uint32_t)(b & 0x7f) << shift;
+        if (!(b & 0x80)) break;
+        shift += 7;
+    }
+    return (int32_t)(u >> 1) ^ -(int32_t)(u & 1);
+}
+
+static inline int32_t quantize(double v, double sca)
+{
+    return (int32_t)std::lround(v * sca);
+}
+
+//==================================================================
+CS_TrajRecorder::CS_TrajRecorder(const std::string& fname, size_t unitsN)
+    : mUnitsN(unitsN),
+      mChunkStepsN(std::clamp(MAX_CHUNK_BYTES / (std::max((size_t)1, unitsN) * FIELDS_N * sizeof(int32_t)),
+                              (size_t)16, (size_t)256))
+{
+    mOFS.open(fname, std::ios::binary | std::ios::trunc);
+    if (!mOFS) return;
+
+    const FileHeader head{FILE_MAGIC, FILE_VERSION, (uint32_t)unitsN, (uint32_t)FIELDS_N};
+    mOFS.write((const char*)&head, sizeof(head));
+
+    mWriterThread = std::thread([this]() { writerThreadFn(); });
+}
+
+CS_TrajRecorder::~CS_TrajRecorder()
+{
+    if (!IsOpen()) return;
+
+    flushCurChunk();
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStopReq = true;
+    }
+    mCV.notify_all();
+    mWriterThread.join();
+}
+
+void CS_TrajRecorder::AddStep(double timeS, const CS_TrajSample* pSamples)
+{
+    if (!IsOpen()) return;
+
+    if (mCurChunk.times.empty())
+    {
+        mCurChunk.firstStep = mStepsN;
+        mCurChunk.vals.reserve(mChunkStepsN * mUnitsN * FIELDS_N);
+    }
+
+    mCurChunk.times.push_back(timeS);
+    for (size_t i = 0; i < mUnitsN; ++i)
+    {
+        const auto& s = pSamples[i];
+        mCurChunk.vals.push_back(quantize(s.mPosX, POS_QUANT));
+        mCurChunk.vals.push_back(quantize(s.mPosZ, POS_QUANT));
+        mCurChunk.vals.push_back(quantize(s.mYaw, YAW_QUANT));
+        mCurChunk.vals.push_back(s.mRunningState);
+        mCurChunk.vals.push_back(quantize(s.mFinalCost, COST_QUANT));
+        for (size_t j = 0; j < CS_CTRL_N; ++j) mCurChunk.vals.push_back(quantize(s.mControls[j], CTRL_QUANT));
+    }
+    ++mStepsN;
+
+    if (mCurChunk.times.size() >= mChunkStepsN) flushCurChunk();
+}
+
+void CS_TrajRecorder::flushCurChunk()
+{
+    if (mCurChunk.times.empty()) return;
+    {
+        // wait for room, to keep the memory bounded
+        std::unique_lock<std::mutex> lock(mMutex);
+        mCV.wait(lock, [this]() { return mQueue.size() < MAX_QUEUED_N; });
+        mQueue.push_back(std::move(mCurChunk));
+    }
+    mCV.notify_all();
+    mCurChunk = {};
+}
+
+void CS_TrajRecorder::writerThreadFn()
+{
+    while (true)
+    {
+        RawChunk chunk;
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mCV.wait(lock, [this]() { return mStopReq || !mQueue.empty(); });
+            if (mQueue.empty()) break;
+            chunk = std::move(mQueue.front());
+            mQueue.pop_front();
+        }
+        mCV.notify_all();
+        writeChunk(chunk);
+    }
+    mOFS.flush();
+}
+
+void CS_TrajRecorder::writeChunk(const RawChunk& chunk)
+{
+    const auto stepsN = chunk.times.size();
+
+    // each unit in its own stream, deltas from its previous step
+    std::vector<uint32_t> unitOffsets(mUnitsN + 1);
+    mEncBuff.clear();
+    for (size_t u = 0; u < mUnitsN; ++u)
+    {
+        unitOffsets[u] = (uint32_t)mEncBuff.size();
+        int32_t prev[FIELDS_N]{};
+        for (size_t s = 0; s < stepsN; ++s)
+        {
+            const auto* pVals = &chunk.vals[(s * mUnitsN + u) * FIELDS_N];
+            for (size_t f = 0; f < FIELDS_N; ++f)
+            {
+                appendVarint(mEncBuff, pVals[f] - prev[f]);
+                prev[f] = pVals[f];
+            }
+        }
+    }
+    unitOffsets[mUnitsN] = (uint32_t)mEncBuff.size();
+
+    const ChunkHeader head{CHUNK_MAGIC, chunk.firstStep, (uint32_t)stepsN, (uint32_t)mEncBuff.size()};
+    mOFS.write((const char*)&head, sizeof(head));
+    mOFS.write((const char*)chunk.times.data(), (std::streamsize)(stepsN * sizeof(double)));
+    mOFS.write((const char*)unitOffsets.data(), (std::streamsize)(unitOffsets.size() * sizeof(uint32_t)));
+    mOFS.write((const char*)mEncBuff.data(), (std::streamsize)mEncBuff.size());
+}
+
+//==================================================================
+bool CS_TrajReader::Open(const std::string& fname)
+{
+    mChunks.clear();
+    mIFS.open(fname, std::ios::binary | std::ios::ate);
+    if (!mIFS) return false;
+
+    const auto fileSize = (uint64_t)mIFS.tellg();
+    mIFS.seekg(0);
+
+    FileHeader head{};
+    if (!mIFS.read((char*)&head, sizeof(head))) return false;
+    if (head.magic != CS_TrajRecorder::FILE_MAGIC || head.version != CS_TrajRecorder::FILE_VERSION ||
+        head.fieldsN != CS_TrajRecorder::FIELDS_N)
+        return false;
+
+    mUnitsN = head.unitsN;
+
+    // find the chunks, keep their times and unit offsets
+    while (true)
+    {
+        ChunkHeader chead{};
+        if (!mIFS.read((char*)&chead, sizeof(chead)) || chead.magic != CS_TrajRecorder::CHUNK_MAGIC) break;
+
+        ChunkInfo ci;
+        ci.firstStep = chead.firstStep;
+        ci.stepsN    = chead.stepsN;
+        ci.times.resize(chead.stepsN);
+        ci.unitOffsets.resize(mUnitsN + 1);
+        if (!mIFS.read((char*)ci.times.data(), (std::streamsize)(ci.times.size() * sizeof(double)))) break;
+        if (!mIFS.read((char*)ci.unitOffsets.data(), (std::streamsize)(ci.unitOffsets.size() * sizeof(uint32_t))))
+            break;
+        ci.dataOffset = (uint64_t)mIFS.tellg();
+
+        // a truncated chunk is left out
+        if (ci.dataOffset + chead.dataSize > fileSize) break;
+
+        mChunks.push_back(std::move(ci));
+        mIFS.seekg((std::streamoff)chead.dataSize, std::ios::cur);
+    }
+    mIFS.clear();
+    return true;
+}
+
+bool CS_TrajReader::ReadSampleAtStep(size_t unitIdx, size_t stepIdx, CS_TrajSample& out) const
+{
+    if (unitIdx >= mUnitsN || stepIdx >= GetStepsN()) return false;
+
+    // the chunk that has the step
+    const auto it = std::upper_bound(mChunks.begin(), mChunks.end(), stepIdx,
+                                     [](size_t s, const ChunkInfo& ci) { return s < ci.firstStep; });
+    const auto& ci = *(it - 1);
+
+    // read only the stream of the unit
+    const auto sta = ci.unitOffsets[unitIdx];
+    const auto end = ci.unitOffsets[unitIdx + 1];
+    mReadBuff.resize(end - sta);
+    mIFS.seekg((std::streamoff)(ci.dataOffset + sta));
+    if (!mIFS.read((char*)mReadBuff.data(), (std::streamsize)mReadBuff.size()))
+    {
+        mIFS.clear();
+        return false;
+    }
+
+    // sum the deltas up to the step
+    int32_t vals[CS_TrajRecorder::FIELDS_N]{};
+    const auto* p    = mReadBuff.data();
+    const auto* pEnd = p + mReadBuff.size();
+    for (size_t s = ci.firstStep; s <= stepIdx; ++s)
+        for (auto& v : vals) v += readVarint(p, pEnd);
+
+    out.mPosX         = (float)(vals[0] / CS_TrajRecorder::POS_QUANT);
+    out.mPosZ         = (float)(vals[1] / CS_TrajRecorder::POS_QUANT);
+    out.mYaw          = (float)(vals[2] / CS_TrajRecorder::YAW_QUANT);
+    out.mRunningState = vals[3];
+    out.mFinalCost    = (float)(vals[4] / CS_TrajRecorder::COST_QUANT);
+    for (size_t j = 0; j < CS_CTRL_N; ++j) out.mControls[j] = (float)(vals[5 + j] / CS_TrajRecorder::CTRL_QUANT);
+    return true;
+}
+
+bool CS_TrajReader::ReadSampleAtTime(size_t unitIdx, double timeS, CS_TrajSample& out) const
+{
+    if (mChunks.empty() || timeS < mChunks.front().times.front()) return false;
+
+    // the last chunk that starts at or before the time, then the last step in it
+    const auto it = std::upper_bound(mChunks.begin(), mChunks.end(), timeS,
+                                     [](double t, const ChunkInfo& ci) { return t < ci.times.front(); });
+    const auto& ci  = *(it - 1);
+    const auto sIt  = std::upper_bound(ci.times.begin(), ci.times.end(), timeS);
+    const auto step = ci.firstStep + (size_t)(sIt - ci.times.begin()) - 1;
+
+    return ReadSampleAtStep(unitIdx, step, out);
+}
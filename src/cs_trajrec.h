@@ -0,0 +1,115 @@
+#ifndef CS_TRAJREC_H
+#define CS_TRAJREC_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "cs_types.h"
+
+// what is recorded of a unit at each step, also what a replay shows (see CS_Sim::GetUnitPose())
+struct CS_TrajSample
+{
+    float mPosX{};
+    float mPosZ{};
+    float mYaw{};
+    float mControls[CS_CTRL_N]{};
+    float mFinalCost{}; // once ended
+    int mRunningState{};
+};
+
+// trajectories of all the units of a sim, streamed to a file
+// values are quantized, then stored as the varint of the delta from the previous step of the same unit
+// steps are grouped in chunks that decode on their own, with the units in separate streams, for random access
+// the sim thread only quantizes into the current chunk, a background thread encodes and writes the full ones
+// (at most a few chunks wait for the writer, then the sim thread waits, so memory is bounded)
+class CS_TrajRecorder
+{
+  public:
+    static constexpr size_t FIELDS_N        = 5 + CS_CTRL_N; // pos x, pos z, yaw, running state, final cost, controls
+    static constexpr double POS_QUANT       = 1000.0;        // millimeters
+    static constexpr double YAW_QUANT       = 10000.0;       // 1/10000 of a radian
+    static constexpr double COST_QUANT      = 100000.0;      // costs are a few units at most
+    static constexpr double CTRL_QUANT      = 255.0;         // controls are in [0, 1]
+    static constexpr size_t MAX_QUEUED_N    = 4;
+    static constexpr size_t MAX_CHUNK_BYTES = 4u << 20;      // of the quantized values, before the encoding
+    static constexpr uint32_t FILE_MAGIC    = 0x43535452;    // "CSTR"
+    static constexpr uint32_t CHUNK_MAGIC   = 0x43535443;    // "CSTC"
+    static constexpr uint32_t FILE_VERSION  = 2;
+
+  private:
+    struct RawChunk
+    {
+        uint32_t firstStep{};
+        std::vector<double> times;
+        std::vector<int32_t> vals; // [step][unit][field]
+    };
+
+    const size_t mUnitsN;
+    const size_t mChunkStepsN;
+
+    std::ofstream mOFS;
+    RawChunk mCurChunk;
+    uint32_t mStepsN{};
+
+    std::mutex mMutex;
+    std::condition_variable mCV;
+    std::deque<RawChunk> mQueue;
+    bool mStopReq{};
+    std::thread mWriterThread;
+
+    // only used by the writer thread
+    std::vector<uint8_t> mEncBuff;
+
+  public:
+    // check IsOpen() for success
+    CS_TrajRecorder(const std::string& fname, size_t unitsN);
+    ~CS_TrajRecorder();
+
+    bool IsOpen() const { return mWriterThread.joinable(); }
+
+    // one sample per unit
+    void AddStep(double timeS, const CS_TrajSample* pSamples);
+
+  private:
+    void flushCurChunk();
+    void writerThreadFn();
+    void writeChunk(const RawChunk& chunk);
+};
+
+// random access to what CS_TrajRecorder wrote (the chunks are found by their headers, so a file of an
+// interrupted run can be read up to its last complete chunk)
+class CS_TrajReader
+{
+    struct ChunkInfo
+    {
+        uint32_t firstStep;
+        uint32_t stepsN;
+        std::vector<double> times;
+        std::vector<uint32_t> unitOffsets; // in the data of the chunk, unitsN + 1
+        uint64_t dataOffset;
+    };
+
+    mutable std::ifstream mIFS;
+    size_t mUnitsN{};
+    std::vector<ChunkInfo> mChunks;
+
+    mutable std::vector<uint8_t> mReadBuff;
+
+  public:
+    bool Open(const std::string& fname);
+
+    size_t GetUnitsN() const { return mUnitsN; }
+    size_t GetStepsN() const { return mChunks.empty() ? 0 : mChunks.back().firstStep + mChunks.back().stepsN; }
+    double GetEndTimeS() const { return mChunks.empty() ? 0.0 : mChunks.back().times.back(); }
+
+    bool ReadSampleAtStep(size_t unitIdx, size_t stepIdx, CS_TrajSample& out) const;
+    // the last step at or before timeS
+    bool ReadSampleAtTime(size_t unitIdx, double timeS, CS_TrajSample& out) const;
+};
+
+#endif
@@ -3,7 +3,31 @@
 
 #include "cs_math.h"
 
+// cost by the distance to the target around the walls (flow field), instead of the straight line
+// (changes the costs, so they aren't comparable with those of the runs without it, see CS_Sim::CODE_VERSION)
+//#define CS_USE_GEODESIC_COST
+// direction of the shortest path to the target as brain inputs (changes the brain's inputs count)
+//#define CS_USE_FLOW_DIR_SENSORS
+// distance to the nearest other unit as a brain input (same as above)
+//#define CS_USE_UNIT_SENSOR
+// units integrated with an exact linear drag, close to the reference at 1/60 s with larger steps, so training
+// can step at 1/20 s (see CS_Unit::CalcIntegratorErr())
+// only the motion is: the crash and wall checks still sample once per step, and at 1/20 s a unit moves up to
+// 3 cells between them, enough to cut the corner of a thin wall (the free space benchmark doesn't cover this)
+//#define CS_USE_EXP_DRAG_INTEGRATOR
+// hit distances of evenly spaced beams all around the unit, instead of the 7 probes ahead of it
+// (see CS_Terrain::ScanLidar(), changes the brain's inputs count)
+//#define CS_USE_LIDAR_SENSOR
+
+// beams of the lidar sensor, beam 0 straight ahead (the range ScanLidar() is meant and checked for)
+static constexpr size_t CS_LIDAR_BEAMS_N = 64;
+static_assert(CS_LIDAR_BEAMS_N >= 32 && CS_LIDAR_BEAMS_N <= 128, "the lidar is for 32 to 128 beams");
+
+#ifdef CS_USE_LIDAR_SENSOR
+static constexpr size_t CS_SENS_PROBES_N = CS_LIDAR_BEAMS_N;
+#else
 static constexpr size_t CS_SENS_PROBES_N = 7;
+#endif
 
 // tags only really used for hand-made brains
 enum CS_SensorType : int {
@@ -20,6 +44,13 @@ enum CS_SensorType : int {
     CS_SENS_PROBE_LAST_HITDIST = CS_SENS_PROBE_FIRST_HITDIST + (int)CS_SENS_PROBES_N - 1,
     CS_SENS_IS_OUTSIDE_MAP,
     CS_SENS_IS_IN_DEAD_ZONE,
+#ifdef CS_USE_FLOW_DIR_SENSORS
+    CS_SENS_FLOW_DIR_X,
+    CS_SENS_FLOW_DIR_Z,
+#endif
+#ifdef CS_USE_UNIT_SENSOR
+    CS_SENS_UNIT_HITDIST,
+#endif
     CS_SENS_N
 };
 
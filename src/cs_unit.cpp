@@ -22,6 +22,23 @@ static const auto MAX_STEER_RAD_S       = (Scalar)ge::ToRad(45.0); // rad/s
 // speed at which we already reach the maximum ability to turn
 static const auto SPEED_OF_MAX_STEER_MS = (Scalar)(MAX_SPEED_MS / 8.0);
 static const auto NOTMOVING_DIST_M      = (Scalar)0.5;
+// velocity attenuation when above the max speed
+static const auto OVERSPEED_ATT         = (Scalar)0.5;
+// step at which the controls were tuned (i.e. braking removes a fraction of the velocity at each step)
+static const auto REF_STEP_S            = (Scalar)(1.0 / 60.0);
+
+#ifdef CS_USE_EXP_DRAG_INTEGRATOR
+static constexpr bool USE_EXP_DRAG = true;
+#else
+static constexpr bool USE_EXP_DRAG = false;
+#endif
+
+// the reference step takes the heading and the speed for the steering at its start, a larger step with the exp
+// drag integrator takes them at the same lag from its middle
+static Scalar calcExpDragRotFrac(double intervalS)
+{
+    return (Scalar)std::max(0.0, 0.5 * (1.0 - (double)REF_STEP_S / intervalS));
+}
 
 CS_UnitDisp::CS_UnitDisp()
 {
@@ -58,8 +75,12 @@ CS_Unit::CS_Unit(const CS_UnitType& type, size_t id, const CS_Pos& pos, bool cre
 
 CS_Unit::~CS_Unit() = default;
 
-void CS_Unit::animate_ApplyControls(double intervalS)
+Scalar CS_Unit::animate_ApplyControls(double intervalS, bool useExpDrag)
 {
+    // exp drag: braking and the over-speed attenuation are a drag, instead of a force and AttenuateVel()
+    Scalar drag = 0;
+    if (useExpDrag && glm::length(mRBody.GetVelWS()) >= MAX_SPEED_MS) drag += OVERSPEED_ATT;
+
     // convert input to impulse forces
     if (const auto unit = (CS_RBody::Scalar)mControls[CS_CTRL_FACCEL]) // acceleration
     {
@@ -73,7 +94,12 @@ void CS_Unit::animate_ApplyControls(double intervalS)
         const auto forceLS = CS_RBody::Vec3{0, 0, valMS2} * mRBody.mMass;
         AddImpForceLS(forceLS);
     }
-    if (const auto unit = (CS_RBody::Scalar)mControls[CS_CTRL_BRAKE]) // braking
+    if (const auto unit = (CS_RBody::Scalar)mControls[CS_CTRL_BRAKE]; unit && useExpDrag) // braking (exp drag)
+    {
+        // removes the same fraction of the velocity as the force below, at each REF_STEP_S
+        drag += -std::log(1 - unit * MAX_BRAKE_COE) / REF_STEP_S;
+    }
+    else if (unit) // braking
     {
         // for braking, first we convert the current rigid body WS acceleration to LS
         // const auto curAccLS = mRBody.CalcRotLS_WS() * mRBody.GetAccWS();
@@ -90,31 +116,51 @@ void CS_Unit::animate_ApplyControls(double intervalS)
     if (const auto unit = (CS_RBody::Scalar)(mControls[CS_CTRL_STEER_L] - mControls[CS_CTRL_STEER_R]))
     {
         const auto curVelLS = mRBody.CalcRotLS_WS() * mRBody.GetVelWS();
+        auto fwdSpeedMS     = -curVelLS[2];
+        // exp drag: the speed where the heading is taken (the forces so far are all from the controls)
+        if (useExpDrag)
+        {
+            const auto fwdAccMS2 = -mImpForcesLS[2] / mRBody.mMass;
+            fwdSpeedMS += (fwdAccMS2 - drag * fwdSpeedMS) * (Scalar)intervalS * calcExpDragRotFrac(intervalS);
+        }
         // quick conversion from speed to steering radius
-        const auto speedCoe = std::min((Scalar)1.0, -curVelLS[2] / SPEED_OF_MAX_STEER_MS);
+        const auto speedCoe = std::min((Scalar)1.0, fwdSpeedMS / SPEED_OF_MAX_STEER_MS);
         const auto valRadS  = unit * MAX_STEER_RAD_S * speedCoe * intervalS;
         mRBody.mAngVelLS[1] = (Scalar)valRadS;
     }
+
+    return drag;
 }
 
-void CS_Unit::AnimateUnit(double curTimeS, double intervalS)
+void CS_Unit::animate_Physics(double intervalS, bool useExpDrag)
 {
-    mState_Death.AnimStateTask(curTimeS);
-
-    animate_ApplyControls(intervalS);
+    const auto drag = animate_ApplyControls(intervalS, useExpDrag);
 
     // iterate the rigid body simulation with optional new forces added
-    mRBody.StepSimulation((Scalar)intervalS, mImpForcesLS, mImpTorquesLS);
-    mImpForcesLS     = {0, 0, 0}; // reset impulse force after being consumed
-    mImpTorquesLS    = {0, 0, 0}; // reset impulse torque after being consumed
-
-    const auto speed = std::max((Scalar)1.0, glm::length(mRBody.GetVelWS()));
+    if (useExpDrag)
+        mRBody.StepSimulationExpDrag((Scalar)intervalS, mImpForcesLS, drag, calcExpDragRotFrac(intervalS));
+    else
+        mRBody.StepSimulation((Scalar)intervalS, mImpForcesLS, mImpTorquesLS);
+    mImpForcesLS  = {0, 0, 0}; // reset impulse force after being consumed
+    mImpTorquesLS = {0, 0, 0}; // reset impulse torque after being consumed
+
+    if (!useExpDrag)
+    {
+        const auto speed = std::max((Scalar)1.0, glm::length(mRBody.GetVelWS()));
 
-    // standard attentuation / hard limit
-    mRBody.AttenuateVel((Scalar)intervalS, (Scalar)(speed < MAX_SPEED_MS ? 0.0 : 0.5));
+        // standard attentuation / hard limit
+        mRBody.AttenuateVel((Scalar)intervalS, (Scalar)(speed < MAX_SPEED_MS ? 0.0 : OVERSPEED_ATT));
+    }
 
     // we reset the angular velocity every time, to simulate just the steering
     mRBody.AttenuateAngVel((Scalar)intervalS, (Scalar)(1.0 / intervalS));
+}
+
+void CS_Unit::AnimateUnit(double curTimeS, double intervalS)
+{
+    mState_Death.AnimStateTask(curTimeS);
+
+    animate_Physics(intervalS, USE_EXP_DRAG);
 
     // update the lifetime
     mLifeTimeS += intervalS;
@@ -123,6 +169,13 @@ void CS_Unit::AnimateUnit(double curTimeS, double intervalS)
     mPosHistory[postHistIdx % std::size(mPosHistory)] = mRBody.GetPosWS();
 }
 
+double CS_Unit::GetSpeedBoundMS()
+{
+    // above the max speed, the attenuation balances the full acceleration at MAX_FACCEL_MS2 / OVERSPEED_ATT
+    // (with some margin for the integration)
+    return (double)std::max(MAX_SPEED_MS, MAX_FACCEL_MS2 / OVERSPEED_ATT) * 1.25;
+}
+
 bool CS_Unit::IsNotMoving() const
 {
     // make sure we have plenty of samples
@@ -140,3 +193,55 @@ bool CS_Unit::IsNotMoving() const
     const auto diff = ma - mi;
     return diff[0] < NOTMOVING_DIST_M && diff[1] < NOTMOVING_DIST_M && diff[2] < NOTMOVING_DIST_M;
 }
+
+CS_Unit::IntegratorErr CS_Unit::CalcIntegratorErr(double stepS)
+{
+    // controls held for a while, to go through acceleration, over-speed, steering, braking and reverse
+    static const struct
+    {
+        double durS;
+        float faccel, baccel, brake, steer; // steer > 0 is left
+    } segs[] = {
+        {3, 1.0f, 0.0f, 0.0f, 0.0f},  //
+        {3, 1.0f, 0.0f, 0.0f, 1.0f},  //
+        {2, 0.6f, 0.0f, 0.0f, -0.5f}, //
+        {2, 0.0f, 0.0f, 1.0f, 0.0f},  //
+        {2, 0.0f, 1.0f, 0.0f, 0.3f},  //
+        {4, 1.0f, 0.0f, 0.4f, -1.0f}, //
+        {4, 0.8f, 0.0f, 0.0f, 0.7f},  //
+        {4, 0.0f, 0.0f, 0.2f, 0.0f},  //
+    };
+
+    CS_Unit ref("bench", 0, CS_Pos(0, 0, 0), false);
+    CS_Unit tst("bench", 1, CS_Pos(0, 0, 0), false);
+    const auto refStepsN = std::max((size_t)1, (size_t)std::lround(stepS / (double)REF_STEP_S));
+
+    IntegratorErr err;
+    for (const auto& seg : segs)
+    {
+        for (auto* pUnit : {&ref, &tst})
+        {
+            pUnit->mControls[CS_CTRL_FACCEL]  = seg.faccel;
+            pUnit->mControls[CS_CTRL_BACCEL]  = seg.baccel;
+            pUnit->mControls[CS_CTRL_BRAKE]   = seg.brake;
+            pUnit->mControls[CS_CTRL_STEER_L] = std::max(seg.steer, 0.f);
+            pUnit->mControls[CS_CTRL_STEER_R] = std::max(-seg.steer, 0.f);
+        }
+
+        const auto stepsN = (size_t)std::lround(seg.durS / stepS);
+        for (size_t i = 0; i < stepsN; ++i)
+        {
+            for (size_t j = 0; j < refStepsN; ++j) ref.animate_Physics((double)REF_STEP_S, false);
+            tst.animate_Physics(stepS, true);
+
+            const auto& refRB = ref.mRBody;
+            const auto& tstRB = tst.mRBody;
+            const auto posErr = glm::length(refRB.GetPosWS() - tstRB.GetPosWS());
+            const auto cosErr = glm::dot(refRB.GetRotWS_LS()[2], tstRB.GetRotWS_LS()[2]);
+            err.mMaxPosErrM   = std::max(err.mMaxPosErrM, (double)posErr);
+            err.mMaxYawErrRad = std::max(err.mMaxYawErrRad, std::acos(std::clamp((double)cosErr, -1.0, 1.0)));
+            err.mDistM += (double)glm::length(refRB.GetVelWS()) * stepS;
+        }
+    }
+    return err;
+}
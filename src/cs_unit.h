@@ -7,6 +7,9 @@
 /*     2022/06/26       */
 /************************/
 
+#include <algorithm>
+#include <array>
+#include <iterator>
 #include <memory>
 #include <string>
 #include <vector>
@@ -58,6 +61,7 @@ class CS_Unit
     CS_UnitType mUnitType{};
     size_t mUnitID{};
     int mRunningState{}; // -1 failed, 0 running, 1 success
+    size_t mEpisodeIdx{}; // see CS_Sim::Params::mEpisodes
     // float           mDeadBendDir    {};
 
     double mFinalCost{};
@@ -66,10 +70,53 @@ class CS_Unit
 
     std::unique_ptr<CS_UnitDisp> moDisp;
 
+  public:
+    // what changes during a simulation, as plain data (see CS_Sim::Snapshot())
+    struct State
+    {
+        float mControls[CS_CTRL_N];
+        double mLifeTimeS;
+        CS_RBody::Vec3 mImpForcesLS;
+        CS_RBody::Vec3 mImpTorquesLS;
+        CS_RBody mRBody;
+        std::array<CS_RBody::Vec3, 60 * 2 / POS_HIST_INTERVAL_S> mPosHistory;
+        int mRunningState;
+        double mFinalCost;
+        StateTask mState_Death;
+    };
+
   public:
     CS_Unit(const CS_UnitType& type, size_t id, const CS_Pos& pos, bool createDisp);
     ~CS_Unit();
 
+    State GetState() const
+    {
+        State st;
+        std::copy(std::begin(mControls), std::end(mControls), st.mControls);
+        st.mLifeTimeS    = mLifeTimeS;
+        st.mImpForcesLS  = mImpForcesLS;
+        st.mImpTorquesLS = mImpTorquesLS;
+        st.mRBody        = mRBody;
+        st.mPosHistory   = mPosHistory;
+        st.mRunningState = mRunningState;
+        st.mFinalCost    = mFinalCost;
+        st.mState_Death  = mState_Death;
+        return st;
+    }
+
+    void SetState(const State& st)
+    {
+        std::copy(std::begin(st.mControls), std::end(st.mControls), mControls);
+        mLifeTimeS    = st.mLifeTimeS;
+        mImpForcesLS  = st.mImpForcesLS;
+        mImpTorquesLS = st.mImpTorquesLS;
+        mRBody        = st.mRBody;
+        mPosHistory   = st.mPosHistory;
+        mRunningState = st.mRunningState;
+        mFinalCost    = st.mFinalCost;
+        mState_Death  = st.mState_Death;
+    }
+
     template <typename VEC_T> void SetControlValues(const VEC_T& controls)
     {
         assert(controls.size() == CS_CTRL_N);
@@ -87,6 +134,22 @@ class CS_Unit
 
     bool IsNotMoving() const;
 
+    // upper bound of the speed that a unit can reach
+    static double GetSpeedBoundMS();
+
+    // how far the exp drag integrator at stepS (a multiple of 1/60 s) gets from the reference one at 1/60 s,
+    // over a fixed sequence of controls (see CS_USE_EXP_DRAG_INTEGRATOR)
+    struct IntegratorErr
+    {
+        double mMaxPosErrM{};
+        double mMaxYawErrRad{};
+        double mDistM{}; // distance traveled, for scale
+    };
+    static IntegratorErr CalcIntegratorErr(double stepS);
+    // what it may give at steps up to 1/15 s (checked by CS_Checks)
+    static constexpr double INTEGRATOR_MAX_POS_ERR_M   = 0.5;
+    static constexpr double INTEGRATOR_MAX_YAW_ERR_RAD = 0.03;
+
     void AddImpForceLS(const glm::dvec3& forceLS) { mImpForcesLS += forceLS; }
 
     void AddImpTorqueLS(const glm::dvec3& torqueLS) { mImpTorquesLS += torqueLS; }
@@ -109,7 +172,9 @@ class CS_Unit
     }
 
   private:
-    void animate_ApplyControls(double intervalS);
+    // returns the drag for StepSimulationExpDrag()
+    CS_RBody::Scalar animate_ApplyControls(double intervalS, bool useExpDrag);
+    void animate_Physics(double intervalS, bool useExpDrag);
 };
 
 #endif
@@ -0,0 +1,101 @@
+#ifndef CS_UNITGRID_H
+#define CS_UNITGRID_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+// uniform grid of the units' positions on the XZ plane, rebuilt at every step with a counting sort
+// the positions are copied, so queries don't race with the units being moved
+class CS_UnitGrid
+{
+    const float mOrgX;
+    const float mOrgZ;
+    const float mCellSize;
+    const int mSizX;
+    const int mSizZ;
+
+    std::vector<uint32_t> mCellStarts; // units of cell c are mSortedIdxs[mCellStarts[c]..mCellStarts[c+1])
+    std::vector<uint32_t> mSortedIdxs;
+    std::vector<uint32_t> mUnitCells;
+    std::vector<float> mPosXs;
+    std::vector<float> mPosZs;
+
+  public:
+    // covering [org, org + fieldSize) on both axes, positions outside are clamped to the border cells
+    CS_UnitGrid(float orgX, float orgZ, float fieldSize, float cellSize)
+        : mOrgX(orgX), mOrgZ(orgZ), mCellSize(cellSize),
+          mSizX(std::max(1, (int)std::ceil(fieldSize / cellSize))), mSizZ(mSizX),
+          mCellStarts((size_t)(mSizX * mSizZ) + 1)
+    {
+    }
+
+    float GetCellSize() const { return mCellSize; }
+
+    // isIncludedFn(i) false to leave a unit out of the grid
+    template <typename POS_FN, typename INC_FN> void Build(size_t n, const POS_FN& getPosFn, const INC_FN& isIncludedFn)
+    {
+        mPosXs.resize(n);
+        mPosZs.resize(n);
+        mUnitCells.resize(n);
+        std::fill(mCellStarts.begin(), mCellStarts.end(), 0);
+
+        // count
+        const auto outCell = (uint32_t)(mSizX * mSizZ);
+        for (size_t i = 0; i < n; ++i)
+        {
+            const auto pos = getPosFn(i);
+            mPosXs[i]      = (float)pos[0];
+            mPosZs[i]      = (float)pos[2];
+            mUnitCells[i]  = isIncludedFn(i) ? toCellIdx(mPosXs[i], mPosZs[i]) : outCell;
+            if (mUnitCells[i] != outCell) ++mCellStarts[mUnitCells[i] + 1];
+        }
+        // prefix sum
+        for (size_t c = 1; c < mCellStarts.size(); ++c) mCellStarts[c] += mCellStarts[c - 1];
+
+        // scatter (stable, units keep their order within a cell)
+        mSortedIdxs.resize(mCellStarts.back());
+        std::vector<uint32_t> fill(mCellStarts.begin(), mCellStarts.end() - 1);
+        for (size_t i = 0; i < n; ++i)
+            if (mUnitCells[i] != outCell) mSortedIdxs[fill[mUnitCells[i]]++] = (uint32_t)i;
+    }
+
+    // fn(idx, dx, dz, dist) for each unit other than selfIdx within radius of (x, z), dx/dz from (x, z) to it
+    template <typename FN> void ForEachNear(float x, float z, float radius, size_t selfIdx, const FN& fn) const
+    {
+        const auto cx0 = clampX((int)std::floor((x - radius - mOrgX) / mCellSize));
+        const auto cx1 = clampX((int)std::floor((x + radius - mOrgX) / mCellSize));
+        const auto cz0 = clampZ((int)std::floor((z - radius - mOrgZ) / mCellSize));
+        const auto cz1 = clampZ((int)std::floor((z + radius - mOrgZ) / mCellSize));
+        const auto r2  = radius * radius;
+        for (int cz = cz0; cz <= cz1; ++cz)
+            for (int cx = cx0; cx <= cx1; ++cx)
+            {
+                const auto c = (size_t)(cx + cz * mSizX);
+                for (auto k = mCellStarts[c]; k < mCellStarts[c + 1]; ++k)
+                {
+                    const auto j = mSortedIdxs[k];
+                    if (j == selfIdx) continue;
+                    const auto dx = mPosXs[j] - x;
+                    const auto dz = mPosZs[j] - z;
+                    const auto d2 = dx * dx + dz * dz;
+                    if (d2 <= r2) fn((size_t)j, dx, dz, std::sqrt(d2));
+                }
+            }
+    }
+
+  private:
+    int clampX(int cx) const { return std::clamp(cx, 0, mSizX - 1); }
+
+    int clampZ(int cz) const { return std::clamp(cz, 0, mSizZ - 1); }
+
+    uint32_t toCellIdx(float x, float z) const
+    {
+        const auto cx = clampX((int)std::floor((x - mOrgX) / mCellSize));
+        const auto cz = clampZ((int)std::floor((z - mOrgZ) / mCellSize));
+        return (uint32_t)(cx + cz * mSizX);
+    }
+};
+
+#endif
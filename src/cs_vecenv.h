@@ -0,0 +1,108 @@
+#ifndef CS_VECENV_H
+#define CS_VECENV_H
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "cs_brainbase.h"
+#include "cs_sim.h"
+#include "cs_threadpool.h"
+
+// brain for sims that get their controls from the outside
+class CS_NoBrain : public CS_BrainBase
+{
+  public:
+    CS_NoBrain() : CS_BrainBase((uint32_t)0, 0, 0) {}
+
+    void AnimateBrain(const CSM_Vec& ins, CSM_Vec& outs) const override
+    {
+        (void)ins;
+        (void)outs;
+    }
+};
+
+// N independent single unit sims, stepped together for external optimizers (e.g. RL)
+// buffers are owned by the caller and contiguous, one row per env:
+//  actions CS_CTRL_N, observations CS_SENS_N (same as the inputs of the brains), costs and dones 1
+// an env that is done is reset right away, with the next seed, and its observation is the first of the new run
+class CS_VecEnv
+{
+    const size_t mEnvsN;
+    CS_Terrain& mTerrain;
+    const CS_Sim::Params mPars;
+    const double mStepS;
+
+    CS_NoBrain mNoBrain;
+    std::vector<std::unique_ptr<CS_Sim>> moSims;
+    std::vector<uint64_t> mSeeds;
+
+  public:
+    CS_VecEnv(size_t envsN, CS_Terrain& terr, const CS_Sim::Params& par, double stepS = 1.0 / 60)
+        : mEnvsN(envsN), mTerrain(terr), mPars(par), mStepS(stepS), moSims(envsN), mSeeds(envsN)
+    {
+    }
+
+    size_t GetEnvsN() const { return mEnvsN; }
+
+    // the seed picks the start/target episode among those of the params
+    void Reset(const uint64_t* pSeeds, float* pObs)
+    {
+        CS_ParallelFor(mEnvsN, CS_GetWorkersN(), [&](size_t i) {
+            resetEnv(i, pSeeds[i]);
+            calcObs(i, pObs + i * CS_SENS_N);
+        });
+    }
+
+    void Step(const float* pActions, float* pObs, float* pCosts, uint8_t* pDones)
+    {
+        CS_ParallelFor(mEnvsN, CS_GetWorkersN(), [&](size_t i) {
+            CS_SCALAR controls[CS_CTRL_N];
+            for (size_t j = 0; j < CS_CTRL_N; ++j) controls[j] = (CS_SCALAR)pActions[i * CS_CTRL_N + j];
+
+            auto& sim = *moSims[i];
+            sim.AnimSim(mStepS, false, controls);
+
+            CS_SCALAR inputsBuff[CS_SENS_N];
+            CSM_Vec inputs(inputsBuff, CS_SENS_N);
+            sim.CalcUnitInputs(0, inputs);
+
+            const auto isDone = sim.GetUnitRunningState(0) != 0 || sim.GetCurSimTimeS() >= mPars.mMaxTimeS;
+            pCosts[i]         = (float)sim.CalcUnitCost(0, inputs);
+            pDones[i]         = (uint8_t)isDone;
+
+            if (isDone)
+            {
+                resetEnv(i, mSeeds[i] + 1);
+                calcObs(i, pObs + i * CS_SENS_N);
+            }
+            else
+            {
+                for (size_t j = 0; j < CS_SENS_N; ++j) pObs[i * CS_SENS_N + j] = (float)inputs[j];
+            }
+        });
+    }
+
+    const CS_Sim& GetEnvSim(size_t envIdx) const { return *moSims[envIdx]; }
+
+  private:
+    void resetEnv(size_t envIdx, uint64_t seed)
+    {
+        auto par = mPars;
+        if (!par.mEpisodes.empty()) par.mEpisodes = {par.mEpisodes[seed % par.mEpisodes.size()]};
+        par.mInitUnitsN     = 1;
+        par.mUnitCollisions = false;
+
+        mSeeds[envIdx]      = seed;
+        moSims[envIdx]      = std::make_unique<CS_Sim>(par, mTerrain, mNoBrain, false);
+    }
+
+    void calcObs(size_t envIdx, float* pObs) const
+    {
+        CS_SCALAR inputsBuff[CS_SENS_N];
+        CSM_Vec inputs(inputsBuff, CS_SENS_N);
+        moSims[envIdx]->CalcUnitInputs(0, inputs);
+        for (size_t j = 0; j < CS_SENS_N; ++j) pObs[j] = (float)inputs[j];
+    }
+};
+
+#endif
@@ -6,6 +6,7 @@
 
 #include <cstdio>
 #include "log/log.h"
+#include "cs_trace.h"
 #include "dglutils.h"
 #include "gl_app.h"
 #include "imgui_impl_glfw.h"
@@ -198,6 +199,7 @@ void GLApp::imguiInit()
 
 void GLApp::newFrame()
 {
+    CS_TRACE_SCOPE("UI frame");
     glfwMakeContextCurrent(mpGLFWWin);
 
     int display_w{};
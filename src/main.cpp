@@ -6,6 +6,8 @@
 /*  © Marco Azimonti    */
 /************************/
 
+#include <string>
+#include "cs_checks.h"
 #include "gl_app.h"
 #include "log/log.h"
 #include <png.h>
@@ -14,7 +16,7 @@
 static void showWinConsole();
 #endif
 
-int main(int, char**)
+int main(int argc, char** argv)
 {
     png_structp png = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
     if(!png) abort();
@@ -30,6 +32,9 @@ int main(int, char**)
         LOGGER_PARAM(logging::FILENAME, "out_pathfinder.log");
         LOGGER_PARAM(logging::FILEOUT, true);
     }
+    // only measure the accuracy and speed of the code, see cs_checks.h
+    if (argc > 1 && std::string(argv[1]) == "--checks") return CS_Checks::RunChecks() ? 0 : 1;
+
     GLApp app;
     app.onInit();
     app.mainLoop();